@@ -0,0 +1,329 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file runs many games side by side for bots to learn on. Every env is a session of its own on the null console,
+ * since observations come from the lanes' bitboards and the frog and drawing the board would be wasted. Nothing in it
+ * waits on the clock, it is stepped with stepGameWithKey, so the moves, deaths and pods are exactly the ones in
+ * player.c and log.c. A fixed pool of workers steps them in lockstep: worker w owns envs w, w+N, w+2N... like the
+ * server, and two barriers start and end every round. Observations, rewards and done flags are kept in one array each
+ * so a caller can hand them straight to a training loop.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "batchenv.h"
+#include "session.h"
+#include "console.h"
+#include "frogger.h"
+#include "gameglobals.h"
+#include "player.h"
+#include "lanes.h"
+#include "bitboard.h"
+#include "replay.h"
+#include "input.h"
+#include "events.h"
+#include "threadwrappers.h"
+
+enum envCommand {resetEnvs, stepEnvs, stopWorkers};
+
+typedef struct ENV_SLOT EnvSlot;
+struct ENV_SLOT {
+   Session *session;
+   Subscriber *outcomes; //deaths, pods and game over, turned into rewards
+   unsigned int seed;
+   bool open;
+};
+
+typedef struct ENV_WORKER EnvWorker;
+struct ENV_WORKER {
+   pthread_t thread;
+   int first;
+   BatchEnv *env;
+};
+
+struct BATCH_ENV {
+   EnvSlot *slots;
+   int numEnvs;
+   int rows, cols;
+   unsigned long maxTicks;
+   unsigned char *observations;
+   float *rewards;
+   unsigned char *done;
+   EnvWorker *workers;
+   int numWorkers;
+   pthread_barrier_t start, finish;
+   //what the workers do next round, only written while they wait on start
+   enum envCommand command;
+   const unsigned int *seeds;
+   const unsigned char *actions;
+};
+
+static const int ACTION_KEYS[NUM_ACTIONS] = {NO_KEY, UP_KEY, DOWN_KEY, LEFT_KEY, RIGHT_KEY};
+
+//---PROTOTYPES---------------------------------------------------------
+static bool openSlot(BatchEnv *env, int i, int cols, int lanes);
+static void closeSlot(EnvSlot *slot);
+static void resetEnv(BatchEnv *env, int i, unsigned int seed);
+static void stepEnv(BatchEnv *env, int i);
+static void observe(BatchEnv *env, int i);
+static int frogRow(BatchEnv *env, Frog *frog);
+static void runRound(BatchEnv *env, enum envCommand command);
+static void *runWorker(void *arg);
+//---METHODS------------------------------------------------------------//
+
+BatchEnv *batchEnvCreate(int envs, int workers, int cols, int lanes, unsigned long maxTicks){
+   Session *caller = currentSession();
+   BatchEnv *env;
+   bool success = true;
+   int i;
+
+   if(envs < 1 || cols < MIN_COLS || cols > MAX_COLS || lanes < 1 || lanes > MAX_LANES){
+      return NULL;
+   }
+   if((env = (BatchEnv *)calloc(1, sizeof(BatchEnv))) == NULL){
+      return NULL;
+   }
+   env->numEnvs = envs;
+   env->numWorkers = workers < 1 ? 1 : workers < envs ? workers : envs;
+   env->rows = lanes + 2;
+   env->cols = cols;
+   env->maxTicks = maxTicks;
+   env->slots = (EnvSlot *)calloc(envs, sizeof(EnvSlot));
+   env->observations = (unsigned char *)calloc((size_t)envs * env->rows * env->cols, 1);
+   env->rewards = (float *)calloc(envs, sizeof(float));
+   env->done = (unsigned char *)calloc(envs, 1);
+   env->workers = (EnvWorker *)calloc(env->numWorkers, sizeof(EnvWorker));
+   if(env->slots == NULL || env->observations == NULL || env->rewards == NULL || env->done == NULL ||
+      env->workers == NULL){
+      env->numEnvs = 0;
+      env->numWorkers = 0;
+      batchEnvDestroy(env);
+      return NULL;
+   }
+   for(i = 0; i < envs && success; i++){
+      success = openSlot(env, i, cols, lanes);
+   }
+   setCurrentSession(caller);
+   if(!success){
+      env->numEnvs = i;
+      env->numWorkers = 0;
+      batchEnvDestroy(env);
+      return NULL;
+   }
+
+   pthread_barrier_init(&env->start, NULL, env->numWorkers + 1);
+   pthread_barrier_init(&env->finish, NULL, env->numWorkers + 1);
+   for(i = 0; i < env->numWorkers; i++){
+      env->workers[i].first = i;
+      env->workers[i].env = env;
+      createThread(&env->workers[i].thread, runWorker, &env->workers[i]);
+   }
+   return env;
+}
+
+void batchEnvReset(BatchEnv *env, const unsigned int seeds[]){
+   env->seeds = seeds;
+   runRound(env, resetEnvs);
+}
+
+void batchEnvStep(BatchEnv *env, const unsigned char actions[]){
+   env->actions = actions;
+   runRound(env, stepEnvs);
+}
+
+int batchEnvCount(BatchEnv *env){
+   return env->numEnvs;
+}
+
+int batchEnvObservationRows(BatchEnv *env){
+   return env->rows;
+}
+
+int batchEnvObservationCols(BatchEnv *env){
+   return env->cols;
+}
+
+const unsigned char *batchEnvObservations(BatchEnv *env){
+   return env->observations;
+}
+
+const float *batchEnvRewards(BatchEnv *env){
+   return env->rewards;
+}
+
+const unsigned char *batchEnvDone(BatchEnv *env){
+   return env->done;
+}
+
+void batchEnvDestroy(BatchEnv *env){
+   Session *caller = currentSession();
+   int i;
+
+   if(env->numWorkers > 0){
+      runRound(env, stopWorkers);
+      pthread_barrier_destroy(&env->start);
+      pthread_barrier_destroy(&env->finish);
+   }
+   for(i = 0; i < env->numEnvs; i++){
+      closeSlot(&env->slots[i]);
+   }
+   setCurrentSession(caller);
+   free(env->slots);
+   free(env->observations);
+   free(env->rewards);
+   free(env->done);
+   free(env->workers);
+   free(env);
+}
+
+/* A session on the null console that is only ever stepped by its worker */
+static bool openSlot(BatchEnv *env, int i, int cols, int lanes){
+   EnvSlot *slot = &env->slots[i];
+   slot->session = newSession(i, -1);
+   setCurrentSession(slot->session);
+   if(!setBoardSize(cols, lanes)){
+      return false;
+   }
+   initLocks();
+   initEvents();
+   initActionQueue();
+   slot->outcomes = subscribe(EVENT_BIT(frogDied) | EVENT_BIT(podReached) | EVENT_BIT(gameOver));
+   consoleSelectBackend(NULL_CONSOLE, NULL);
+   return true;
+}
+
+static void closeSlot(EnvSlot *slot){
+   if(slot->session == NULL){
+      return;
+   }
+   setCurrentSession(slot->session);
+   destroyEvents();
+   deleteInput();
+   if(slot->open){
+      closeGame();
+   }
+   destroyLocks();
+   freeSession(slot->session);
+   slot->session = NULL;
+}
+
+static void resetEnv(BatchEnv *env, int i, unsigned int seed){
+   EnvSlot *slot = &env->slots[i];
+   GameEvent event;
+
+   setCurrentSession(slot->session);
+   if(slot->open){
+      closeGame();
+   }
+   while(pollEvent(slot->outcomes, &event)); //left over from the last game
+   if(!openGame(seed)){
+      printError();
+   }
+   slot->open = true;
+   slot->seed = seed;
+   env->rewards[i] = 0;
+   env->done[i] = false;
+   observe(env, i);
+}
+
+/* One tick of one env, on the worker that owns it. The frog's deaths are picked
+   up after the tick, like runGame and the server do */
+static void stepEnv(BatchEnv *env, int i){
+   EnvSlot *slot = &env->slots[i];
+   int action = env->actions[i];
+   float reward = 0;
+   GameEvent event;
+
+   if(env->done[i]){
+      resetEnv(env, i, slot->seed + env->numEnvs);
+      return;
+   }
+   setCurrentSession(slot->session);
+   stepGameWithKey(action < NUM_ACTIONS ? ACTION_KEYS[action] : NO_KEY);
+   while(pollEvent(slot->outcomes, &event)){
+      if(event.type == frogDied){
+         reward += REWARD_DEATH;
+         loseLife();
+      }
+      else if(event.type == podReached){
+         reward += REWARD_POD;
+      }
+   }
+   env->rewards[i] = reward;
+   env->done[i] = isGameOver() || (env->maxTicks > 0 && getTick() >= env->maxTicks);
+   observe(env, i);
+}
+
+/* The board with one row per lane: the pods on the home bank, the columns of every lane
+   a log can carry the frog over, the start bank, and the frog on top */
+static void observe(BatchEnv *env, int i){
+   unsigned char *cells = env->observations + (size_t)i * env->rows * env->cols;
+   Frog *frog = getFrog();
+   const uint64_t *words;
+   int row, col, pod;
+
+   memset(cells, CELL_BANK, env->cols);
+   for(pod = 0; pod < NUM_PODS; pod++){
+      memset(cells + podCol(pod), frog->podFull[pod] ? CELL_FULL_POD : CELL_POD, POD_WIDTH);
+   }
+   for(row = 1; row < env->rows - 1; row++){
+      words = laneAt(row - 1)->carries.words;
+      for(col = 0; col < env->cols; col++){ //straight off the words, CELL_LOG is CELL_WATER+1
+         cells[row*env->cols + col] = CELL_WATER + (words[col / BITBOARD_WORD] >> (col % BITBOARD_WORD) & 1);
+      }
+   }
+   memset(cells + (env->rows - 1)*env->cols, CELL_BANK, env->cols);
+   memset(cells + frogRow(env, frog)*env->cols + frog->currPos[1], CELL_FROG, frog->width);
+}
+
+static int frogRow(BatchEnv *env, Frog *frog){
+   int row;
+   if(frog->currPos[0] < laneRow(0))
+      row = 0;
+   else if(frog->currPos[0] >= startBank())
+      row = env->rows - 1;
+   else
+      row = (frog->currPos[0] - laneRow(0)) / LANE_HEIGHT + 1;
+   return row;
+}
+
+/* Hands the workers a command and waits until every one of them is done with it */
+static void runRound(BatchEnv *env, enum envCommand command){
+   int i;
+   env->command = command;
+   pthread_barrier_wait(&env->start);
+   if(command == stopWorkers){
+      for(i = 0; i < env->numWorkers; i++){
+         joinThread(env->workers[i].thread);
+      }
+   }
+   else{
+      pthread_barrier_wait(&env->finish);
+   }
+}
+
+static void *runWorker(void *arg){
+   EnvWorker *worker = (EnvWorker *)arg;
+   BatchEnv *env = worker->env;
+   int i;
+
+   pthread_barrier_wait(&env->start);
+   while(env->command != stopWorkers){
+      for(i = worker->first; i < env->numEnvs; i += env->numWorkers){
+         if(env->command == resetEnvs)
+            resetEnv(env, i, env->seeds[i]);
+         else
+            stepEnv(env, i);
+      }
+      pthread_barrier_wait(&env->finish);
+      pthread_barrier_wait(&env->start);
+   }
+   pthread_exit(NULL);
+}
@@ -0,0 +1,55 @@
+/* The header file for batchenv.c
+*/
+
+#ifndef BATCHENV_H
+#define BATCHENV_H
+#include <stdbool.h>
+
+/* What a bot can do in one step */
+enum envAction {ACTION_NONE, ACTION_UP, ACTION_DOWN, ACTION_LEFT, ACTION_RIGHT, NUM_ACTIONS};
+
+/* What an observation cell holds. CELL_LOG has to stay right after CELL_WATER */
+enum envCell {CELL_WATER, CELL_LOG, CELL_BANK, CELL_POD, CELL_FULL_POD, CELL_FROG};
+
+#define REWARD_POD 1.0f    //frog made it into an empty pod
+#define REWARD_DEATH -1.0f //frog fell in the water
+
+typedef struct BATCH_ENV BatchEnv;
+
+/* Makes `envs' games on a `cols' by `lanes' board, stepped together by a pool
+   of `workers' threads. A game is done when it is lost or won, or after
+   `maxTicks' steps if that isn't 0. Returns NULL if the board size is out of
+   range or the games can't be set up */
+BatchEnv *batchEnvCreate(int envs, int workers, int cols, int lanes, unsigned long maxTicks);
+
+/* Starts a new game in every env, env i seeded with seeds[i], and fills in the
+   first observations */
+void batchEnvReset(BatchEnv *env, const unsigned int seeds[]);
+
+/* Steps every env one tick in lockstep, env i taking actions[i], and fills in
+   the observations, rewards and done flags. An env that was done on the last
+   step starts a new game instead, seeded with its last seed plus the number
+   of envs, and reports its first observation */
+void batchEnvStep(BatchEnv *env, const unsigned char actions[]);
+
+/* Number of envs */
+int batchEnvCount(BatchEnv *env);
+
+/* Rows and columns of one observation. Row 0 is the home bank, rows 1 to
+   lanes are the lanes and the last row is the start bank */
+int batchEnvObservationRows(BatchEnv *env);
+int batchEnvObservationCols(BatchEnv *env);
+
+/* Every env's observation, one after the other, each rows*cols envCell bytes */
+const unsigned char *batchEnvObservations(BatchEnv *env);
+
+/* Every env's reward for the last step */
+const float *batchEnvRewards(BatchEnv *env);
+
+/* Every env's done flag for the last step */
+const unsigned char *batchEnvDone(BatchEnv *env);
+
+/* Stops the workers and frees every game */
+void batchEnvDestroy(BatchEnv *env);
+
+#endif
@@ -0,0 +1,377 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * Microbenchmarks for the hot paths: drawing and clearing on the console, moving and animating a log, looking for the
+ * frog on a lane full of logs, and spawning/retiring logs in a lane. The cell kernels under the console are run with
+ * each of their scalar, SSE2 and AVX2 versions so the speedup shows. Runs on the headless console so no terminal is
+ * needed. The log motion kernel steps a lane of a few thousand logs per op, also with each of its versions. The batch
+ * env is stepped with random moves, one op being a step of all of its envs. The timer wheel is run one tick per op with
+ * a new timer every tick, now and then one far enough off to be cascaded. A traced span is timed with tracing off and
+ * on. Every benchmark prints one JSON line with ns/op percentiles over its samples, so runs can be diffed.
+ *
+ * Build and run with `make bench'.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "console.h"
+#include "gameglobals.h"
+#include "log.h"
+#include "lanes.h"
+#include "player.h"
+#include "threadwrappers.h"
+#include "session.h"
+#include "blit.h"
+#include "batchenv.h"
+#include "timerwheel.h"
+#include "trace.h"
+
+#define SAMPLES 200
+#define BATCH 1000
+#define MAX_LANE_LOGS 10000
+#define NSEC_PER_SEC 1000000000L
+#define BATCH_ENVS 64
+#define MOTION_LOGS 4096
+
+typedef struct BENCH Bench;
+struct BENCH {
+   const char *name;
+   void (*setup)(void);
+   void (*run)(void);
+};
+
+static Log benchLog;
+static char rowCells[VIEW_COLS];
+static char rowSprite[VIEW_COLS];
+static BatchEnv *batchEnv = NULL;
+static unsigned char batchActions[BATCH_ENVS];
+static unsigned int batchRng = 1;
+static Log *motionDue[MAX_LANE_LOGS+1];
+static int motionCols[MAX_LANE_LOGS+1];
+static unsigned char motionFlags[MAX_LANE_LOGS+1];
+static int motionStart[MAX_LANE_LOGS+1]; //positions the motion lane goes back to now and then
+static int motionTicks = 0;
+static unsigned int timerRng = 1;
+static long timersRun = 0;
+
+//---PROTOTYPES---------------------------------------------------------
+static void runBench(Bench *bench);
+static long elapsedNsec(struct timespec *from, struct timespec *to);
+static int compareDoubles(const void *a, const void *b);
+static void fillLane(int count);
+//---SETUP-AND-RUN------------------------------------------------------//
+
+static void drawInside(){
+   consoleDrawImage(SAFE_BANK, 20, &logSprite, first);
+}
+
+static void drawClipLeft(){
+   consoleDrawImage(SAFE_BANK, -10, &logSprite, first);
+}
+
+static void drawClipRight(){
+   consoleDrawImage(SAFE_BANK, boardCols()-10, &logSprite, first);
+}
+
+static void clearLog(){
+   consoleClearImage(SAFE_BANK, 20, LOG_HEIGHT, 24);
+}
+
+static void setupLog(){
+   int row = laneRow(0);
+   logStartup(&benchLog, &row);
+}
+
+static void stepLog(){
+   moveLog(&benchLog);
+   if(benchLog.dead){ //wrap back on screen instead of measuring a dead log
+      setupLog();
+   }
+}
+
+static void setupFrog(){
+   Frog *frog = getFrog();
+   frog->currPos[0] = frog->prevPos[0] = laneRow(0)+1;
+   frog->currPos[1] = frog->prevPos[1] = 40;
+}
+
+static void setup10(){ fillLane(10); setupFrog(); }
+static void setup100(){ fillLane(100); setupFrog(); }
+static void setup10k(){ fillLane(MAX_LANE_LOGS); setupFrog(); }
+
+static void frogOnLog(){
+   isFrogOnAnyLog();
+}
+
+static void setupSpawn(){
+   fillLane(0);
+}
+
+static void spawnAndRetire(){
+   Lane *lane = laneAt(1);
+   int row = laneRow(1);
+   Log *log = allocLog();
+   logStartup(log, &row);
+   lockMutex(&lane->lock);
+   laneInsert(lane, log);
+   laneRemove(lane, laneFront(lane));
+   unlockMutex(&lane->lock);
+}
+
+static void useScalar(){ blitSelect(BLIT_SCALAR); }
+static void useSse2(){ blitSelect(BLIT_SSE2); }
+static void useAvx2(){ blitSelect(BLIT_AVX2); }
+
+static void copyRow(){
+   blitCopy(rowCells, rowSprite, VIEW_COLS);
+}
+
+static void maskRow(){
+   blitMasked(rowCells, rowSprite, VIEW_COLS);
+}
+
+static void fillRow(){
+   blitFill(rowCells, ' ', VIEW_COLS);
+}
+
+/* A lane of logs spread over the board, overlapping, which the kernel doesn't mind */
+static void setupMotion(){
+   Lane *lane = laneAt(2);
+   int row = laneRow(2);
+   Log *log;
+   int i;
+
+   lockMutex(&lane->lock);
+   while((log = laneFront(lane)) != NULL){
+      laneRemove(lane, log);
+   }
+   for(i = 0; i < MOTION_LOGS; i++){
+      log = allocLog();
+      logStartup(log, &row);
+      log->currCol = log->prevCol = i % boardCols();
+      laneInsert(lane, log);
+   }
+   unlockMutex(&lane->lock);
+   memcpy(motionStart, lane->motion.pos, lane->capacity * sizeof(int));
+   motionTicks = 0;
+}
+
+static void motionScalar(){ useScalar(); setupMotion(); }
+static void motionSse2(){ useSse2(); setupMotion(); }
+static void motionAvx2(){ useAvx2(); setupMotion(); }
+
+static void stepMotion(){
+   Lane *lane = laneAt(2);
+   if(++motionTicks % BATCH == 0){ //back where they started before they drift too far
+      memcpy(lane->motion.pos, motionStart, lane->capacity * sizeof(int));
+   }
+   laneStepMotion(lane, motionDue, motionCols, motionFlags);
+}
+
+static void drawSprite(){
+   consoleDrawSprite(SAFE_BANK, 20, &logSprite, first);
+}
+
+static void setupBatch(){
+   unsigned int seeds[BATCH_ENVS];
+   int i;
+   if(batchEnv == NULL){
+      batchEnv = batchEnvCreate(BATCH_ENVS, sysconf(_SC_NPROCESSORS_ONLN), DEFAULT_COLS, DEFAULT_LANES, 0);
+      if(batchEnv == NULL){
+         fprintf(stderr, "can't set up the batch env\n");
+         exit(1);
+      }
+   }
+   for(i = 0; i < BATCH_ENVS; i++){
+      seeds[i] = i + 1;
+   }
+   batchEnvReset(batchEnv, seeds);
+}
+
+static void stepBatch(){
+   int i;
+   for(i = 0; i < BATCH_ENVS; i++){ //xorshift, random moves without rand()'s lock
+      batchRng ^= batchRng << 13;
+      batchRng ^= batchRng >> 17;
+      batchRng ^= batchRng << 5;
+      batchActions[i] = batchRng % NUM_ACTIONS;
+   }
+   batchEnvStep(batchEnv, batchActions);
+}
+
+static void countTimer(void *arg){
+   timersRun++;
+}
+
+static void setupTimers(){
+   if(currentSession()->timers == NULL && !initTimers()){
+      fprintf(stderr, "can't set up the timers\n");
+      exit(1);
+   }
+}
+
+static void tickTimers(){
+   timerRng ^= timerRng << 13;
+   timerRng ^= timerRng >> 17;
+   timerRng ^= timerRng << 5;
+   //about half of MAX_TIMERS pending, one in 16 out past level 0
+   scheduleTimer(timerRng % 16 == 0 ? timerRng % 256 + 1 : timerRng % 16 + 1, countTimer, NULL);
+   runTimers(++currentSession()->tick);
+}
+
+static void traceOff(){
+   atomic_store_explicit(&tracing, false, memory_order_release);
+}
+
+static void traceOn(){
+   atomic_store_explicit(&tracing, true, memory_order_release); //no trace file, so nothing is written on exit
+}
+
+static void traceSpan(){
+   traceBegin("bench");
+   traceEnd();
+}
+
+static Bench benches[] = {
+   {"blitCopy/80/scalar", useScalar, copyRow},
+   {"blitCopy/80/sse2", useSse2, copyRow},
+   {"blitCopy/80/avx2", useAvx2, copyRow},
+   {"blitMasked/80/scalar", useScalar, maskRow},
+   {"blitMasked/80/sse2", useSse2, maskRow},
+   {"blitMasked/80/avx2", useAvx2, maskRow},
+   {"blitFill/80/scalar", useScalar, fillRow},
+   {"blitFill/80/sse2", useSse2, fillRow},
+   {"blitFill/80/avx2", useAvx2, fillRow},
+   {"consoleDrawImage/inside/scalar", useScalar, drawInside},
+   {"consoleDrawSprite/inside/scalar", useScalar, drawSprite},
+   {"consoleClearImage/scalar", useScalar, clearLog},
+   {"consoleDrawImage/inside", NULL, drawInside},
+   {"consoleDrawSprite/inside", NULL, drawSprite},
+   {"consoleDrawImage/clip_left", NULL, drawClipLeft},
+   {"consoleDrawImage/clip_right", NULL, drawClipRight},
+   {"consoleClearImage", NULL, clearLog},
+   {"moveLog", setupLog, stepLog},
+   {"isFrogOnAnyLog/10", setup10, frogOnLog},
+   {"isFrogOnAnyLog/100", setup100, frogOnLog},
+   {"isFrogOnAnyLog/10000", setup10k, frogOnLog},
+   {"laneInsert+laneRemove", setupSpawn, spawnAndRetire},
+   {"laneStepMotion/4096/scalar", motionScalar, stepMotion},
+   {"laneStepMotion/4096/sse2", motionSse2, stepMotion},
+   {"laneStepMotion/4096/avx2", motionAvx2, stepMotion},
+   {"batchEnvStep/64", setupBatch, stepBatch},
+   {"runTimers+scheduleTimer", setupTimers, tickTimers},
+   {"traceSpan/off", traceOff, traceSpan},
+   {"traceSpan/on", traceOn, traceSpan}, //last, so tracing stays off for the rest
+};
+
+//---METHODS------------------------------------------------------------//
+int main(int argc, char **argv){
+   int rows[] = {laneRow(0), laneRow(1), laneRow(2), laneRow(3)};
+   Session *session = newSession(0, -1);
+   int i;
+
+   setCurrentSession(session);
+   initLockStats();
+   consoleSelectBackend(HEADLESS_CONSOLE, NULL);
+   initLocks();
+   if(!drawScreen()){
+      fprintf(stderr, "can't set up the console\n");
+      return 1;
+   }
+   createFrog();
+   if(!initLanes(rows, 4, boardCols(), MAX_LANE_LOGS+1)){
+      fprintf(stderr, "can't set up the lanes\n");
+      return 1;
+   }
+
+   for(i = 0; i < VIEW_COLS; i++){ //a log row half over the background
+      rowCells[i] = '.';
+      rowSprite[i] = i % 24 == 0 ? '/' : i % 24 < 12 ? '=' : ' ';
+   }
+   for(i = 0; i < sizeof(benches)/sizeof(benches[0]); i++){
+      if(argc < 2 || strstr(benches[i].name, argv[1]) != NULL){
+         runBench(&benches[i]);
+      }
+   }
+
+   if(batchEnv != NULL){
+      batchEnvDestroy(batchEnv);
+   }
+   if(session->timers != NULL){
+      deleteTimers();
+   }
+   deleteLanes();
+   deletePlayer();
+   consoleFinish();
+   destroyLocks();
+   freeSession(session);
+   return 0;
+}
+
+static void runBench(Bench *bench){
+   double nsPerOp[SAMPLES];
+   double total = 0;
+   struct timespec start, end;
+   int i, j;
+
+   blitSelect(BLIT_AUTO); //kernel benches pick theirs in setup
+   if(bench->setup != NULL){
+      bench->setup();
+   }
+   for(j = 0; j < BATCH; j++){ //warm up
+      bench->run();
+   }
+   for(i = 0; i < SAMPLES; i++){
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for(j = 0; j < BATCH; j++){
+         bench->run();
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      nsPerOp[i] = (double)elapsedNsec(&start, &end) / BATCH;
+      total += nsPerOp[i];
+   }
+   qsort(nsPerOp, SAMPLES, sizeof(double), compareDoubles);
+
+   printf("{\"bench\":\"%s\",\"kernel\":\"%s\",\"samples\":%d,\"batch\":%d,\"ns_per_op\":{\"mean\":%.1f,\"min\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f}}\n",
+          bench->name, blitKernelName(), SAMPLES, BATCH, total / SAMPLES, nsPerOp[0], nsPerOp[SAMPLES/2], nsPerOp[SAMPLES*90/100],
+          nsPerOp[SAMPLES*99/100], nsPerOp[SAMPLES-1]);
+   fflush(stdout);
+}
+
+/* Puts `count' logs in the first lane, spaced out along it in spawn order and
+   wrapped around the board once they reach its end */
+static void fillLane(int count){
+   Lane *lane = laneAt(0);
+   int row = laneRow(0);
+   Log *log;
+   int i;
+
+   lockMutex(&lane->lock);
+   while((log = laneFront(lane)) != NULL){
+      laneRemove(lane, log);
+   }
+   for(i = 0; i < count; i++){
+      log = allocLog();
+      logStartup(log, &row);
+      log->currCol = log->prevCol = i*(log->width+6) % boardCols();
+      laneInsert(lane, log);
+   }
+   unlockMutex(&lane->lock);
+}
+
+static long elapsedNsec(struct timespec *from, struct timespec *to){
+   return (to->tv_sec - from->tv_sec) * NSEC_PER_SEC + (to->tv_nsec - from->tv_nsec);
+}
+
+static int compareDoubles(const void *a, const void *b){
+   double x = *(const double *)a;
+   double y = *(const double *)b;
+   return (x > y) - (x < y);
+}
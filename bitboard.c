@@ -0,0 +1,86 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file is a row of bits, one per board column, so questions like "is every column under the frog on a log" are a
+ * couple of masks and a popcount instead of a walk over the logs. A range only touches the words it covers, and
+ * anything the frog or a log covers fits in one or two of them.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "bitboard.h"
+
+//---PROTOTYPES---------------------------------------------------------
+static bool clip(Bitboard *board, int *fromCol, int *toCol);
+static uint64_t wordMask(int word, int fromCol, int toCol);
+//---METHODS------------------------------------------------------------//
+
+bool bitboardInit(Bitboard *board, int cols){
+   board->cols = cols;
+   board->words = (uint64_t *)calloc((cols + BITBOARD_WORD - 1) / BITBOARD_WORD, sizeof(uint64_t));
+   return board->words != NULL;
+}
+
+void bitboardFree(Bitboard *board){
+   free(board->words);
+   board->words = NULL;
+   board->cols = 0;
+}
+
+void bitboardSetRange(Bitboard *board, int fromCol, int toCol, bool set){
+   int word;
+   if(!clip(board, &fromCol, &toCol)){
+      return;
+   }
+   for(word = fromCol / BITBOARD_WORD; word <= toCol / BITBOARD_WORD; word++){
+      if(set)
+         board->words[word] |= wordMask(word, fromCol, toCol);
+      else
+         board->words[word] &= ~wordMask(word, fromCol, toCol);
+   }
+}
+
+bool bitboardTest(Bitboard *board, int col){
+   return col >= 0 && col < board->cols && (board->words[col / BITBOARD_WORD] >> (col % BITBOARD_WORD) & 1);
+}
+
+int bitboardCount(Bitboard *board, int fromCol, int toCol){
+   int count = 0;
+   int word;
+   if(!clip(board, &fromCol, &toCol)){
+      return 0;
+   }
+   for(word = fromCol / BITBOARD_WORD; word <= toCol / BITBOARD_WORD; word++){
+      count += __builtin_popcountll(board->words[word] & wordMask(word, fromCol, toCol));
+   }
+   return count;
+}
+
+bool bitboardAll(Bitboard *board, int fromCol, int toCol){
+   return fromCol >= 0 && toCol < board->cols && fromCol <= toCol &&
+      bitboardCount(board, fromCol, toCol) == toCol - fromCol + 1;
+}
+
+/* Trims the range to the board. Returns false if nothing is left */
+static bool clip(Bitboard *board, int *fromCol, int *toCol){
+   if(*fromCol < 0)
+      *fromCol = 0;
+   if(*toCol > board->cols - 1)
+      *toCol = board->cols - 1;
+   return *fromCol <= *toCol;
+}
+
+/* The bits of `word' that fall inside the range */
+static uint64_t wordMask(int word, int fromCol, int toCol){
+   int low = fromCol - word * BITBOARD_WORD;
+   int high = toCol - word * BITBOARD_WORD;
+   uint64_t mask = ~(uint64_t)0;
+   if(low > 0)
+      mask &= mask << low;
+   if(high < BITBOARD_WORD - 1)
+      mask &= ~(~(uint64_t)0 << (high + 1));
+   return mask;
+}
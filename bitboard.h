@@ -0,0 +1,36 @@
+/* The header file for bitboard.c
+*/
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BITBOARD_WORD 64 //columns per word
+
+/* One bit per board column */
+typedef struct BITBOARD Bitboard;
+struct BITBOARD {
+   uint64_t *words;
+   int cols;
+};
+
+/* Allocates a bitboard for `cols' columns, all clear */
+bool bitboardInit(Bitboard *board, int cols);
+
+/* Frees the words of the bitboard */
+void bitboardFree(Bitboard *board);
+
+/* Sets or clears columns `fromCol' to `toCol'. Columns off the board are ignored */
+void bitboardSetRange(Bitboard *board, int fromCol, int toCol, bool set);
+
+/* Returns true if the column is on the board and set */
+bool bitboardTest(Bitboard *board, int col);
+
+/* Returns how many of columns `fromCol' to `toCol' are set */
+int bitboardCount(Bitboard *board, int fromCol, int toCol);
+
+/* Returns true if every one of columns `fromCol' to `toCol' is on the board and set */
+bool bitboardAll(Bitboard *board, int fromCol, int toCol);
+
+#endif
@@ -0,0 +1,268 @@
+/**********************************************************************
+  Module: blit.c
+
+  Purpose: Cell copy and fill kernels. see blit.h
+
+  NOTES: the AVX2 kernels are compiled with a target attribute and only
+	 picked when the CPU reports AVX2, so the build doesn't need
+	 -mavx2. SSE2 is always there on x86-64. Anything else gets the
+	 scalar kernels.
+**********************************************************************/
+
+#include "blit.h"
+#include <stdbool.h>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define BLIT_X86
+#include <immintrin.h>
+#endif
+
+#define BLANK ' '
+
+typedef struct BLIT_KERNELS BlitKernels;
+struct BLIT_KERNELS {
+	const char *name;
+	enum blitKernel kernel;
+	void (*copy)(char *dst, const char *src, int len);
+	void (*masked)(char *dst, const char *src, int len);
+	void (*fill)(char *dst, char cell, int len);
+};
+
+/* Local functions */
+
+/****************************** scalar ******************************/
+
+static void scalarCopy(char *dst, const char *src, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = src[i];
+}
+
+static void scalarMasked(char *dst, const char *src, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		if (src[i] != BLANK)
+			dst[i] = src[i];
+}
+
+static void scalarFill(char *dst, char cell, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = cell;
+}
+
+static const BlitKernels scalarKernels = {"scalar", BLIT_SCALAR, scalarCopy, scalarMasked, scalarFill};
+
+#ifdef BLIT_X86
+
+/******************************* SSE2 *******************************/
+
+static void sse2Copy(char *dst, const char *src, int len)
+{
+	int i;
+
+	if (len < 16)
+	{
+		scalarCopy(dst, src, len);
+		return;
+	}
+	for (i = 0; i + 16 <= len; i += 16)
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_loadu_si128((const __m128i *)(src + i)));
+	if (i < len)	/* last 16 again, overlapping what was already copied */
+		_mm_storeu_si128((__m128i *)(dst + len - 16), _mm_loadu_si128((const __m128i *)(src + len - 16)));
+}
+
+/* dst = blank ? dst : src, with and/andnot/or since SSE2 has no blend */
+static __m128i sse2Blend(__m128i under, __m128i sprite, __m128i blanks)
+{
+	__m128i blank = _mm_cmpeq_epi8(sprite, blanks);
+
+	return _mm_or_si128(_mm_and_si128(blank, under), _mm_andnot_si128(blank, sprite));
+}
+
+static void sse2Masked(char *dst, const char *src, int len)
+{
+	__m128i blanks = _mm_set1_epi8(BLANK);
+	__m128i under, sprite, tail;
+	int i;
+
+	if (len < 16)
+	{
+		scalarMasked(dst, src, len);
+		return;
+	}
+	/* the last 16 are blended up front, reading them back after the loop
+	   stored over part of them would stall on store forwarding. Blending
+	   twice gives the same cells, so the overlap is safe */
+	tail = sse2Blend(_mm_loadu_si128((const __m128i *)(dst + len - 16)),
+		_mm_loadu_si128((const __m128i *)(src + len - 16)), blanks);
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		under = _mm_loadu_si128((const __m128i *)(dst + i));
+		sprite = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), sse2Blend(under, sprite, blanks));
+	}
+	if (i < len)
+		_mm_storeu_si128((__m128i *)(dst + len - 16), tail);
+}
+
+static void sse2Fill(char *dst, char cell, int len)
+{
+	__m128i cells = _mm_set1_epi8(cell);
+	int i;
+
+	if (len < 16)
+	{
+		scalarFill(dst, cell, len);
+		return;
+	}
+	for (i = 0; i + 16 <= len; i += 16)
+		_mm_storeu_si128((__m128i *)(dst + i), cells);
+	if (i < len)
+		_mm_storeu_si128((__m128i *)(dst + len - 16), cells);
+}
+
+static const BlitKernels sse2Kernels = {"sse2", BLIT_SSE2, sse2Copy, sse2Masked, sse2Fill};
+
+/******************************* AVX2 *******************************/
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static void avx2Copy(char *dst, const char *src, int len)
+{
+	int i;
+
+	if (len < 32)
+	{
+		sse2Copy(dst, src, len);
+		return;
+	}
+	for (i = 0; i + 32 <= len; i += 32)
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_loadu_si256((const __m256i *)(src + i)));
+	if (i < len)
+		_mm256_storeu_si256((__m256i *)(dst + len - 32), _mm256_loadu_si256((const __m256i *)(src + len - 32)));
+}
+
+AVX2 static void avx2Masked(char *dst, const char *src, int len)
+{
+	__m256i blanks = _mm256_set1_epi8(BLANK);
+	__m256i under, sprite, tail;
+	int i;
+
+	if (len < 32)
+	{
+		sse2Masked(dst, src, len);
+		return;
+	}
+	sprite = _mm256_loadu_si256((const __m256i *)(src + len - 32));	/* see sse2Masked */
+	tail = _mm256_blendv_epi8(sprite, _mm256_loadu_si256((const __m256i *)(dst + len - 32)),
+		_mm256_cmpeq_epi8(sprite, blanks));
+	for (i = 0; i + 32 <= len; i += 32)
+	{
+		under = _mm256_loadu_si256((const __m256i *)(dst + i));
+		sprite = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dst + i),
+			_mm256_blendv_epi8(sprite, under, _mm256_cmpeq_epi8(sprite, blanks)));
+	}
+	if (i < len)
+		_mm256_storeu_si256((__m256i *)(dst + len - 32), tail);
+}
+
+AVX2 static void avx2Fill(char *dst, char cell, int len)
+{
+	__m256i cells = _mm256_set1_epi8(cell);
+	int i;
+
+	if (len < 32)
+	{
+		sse2Fill(dst, cell, len);
+		return;
+	}
+	for (i = 0; i + 32 <= len; i += 32)
+		_mm256_storeu_si256((__m256i *)(dst + i), cells);
+	if (i < len)
+		_mm256_storeu_si256((__m256i *)(dst + len - 32), cells);
+}
+
+static const BlitKernels avx2Kernels = {"avx2", BLIT_AVX2, avx2Copy, avx2Masked, avx2Fill};
+
+#endif /* BLIT_X86 */
+
+static const BlitKernels *active = NULL;
+
+static const BlitKernels *bestKernels(void)
+{
+#ifdef BLIT_X86
+	if (__builtin_cpu_supports("avx2"))
+		return (&avx2Kernels);
+	return (&sse2Kernels);
+#else
+	return (&scalarKernels);
+#endif
+}
+
+/* Every thread picks the same kernels, so racing on the first use is harmless */
+static const BlitKernels *kernels(void)
+{
+	if (active == NULL)
+		active = bestKernels();
+	return (active);
+}
+
+/********************** Interface functions ***********************/
+
+bool blitSelect(enum blitKernel kernel)
+{
+	switch (kernel)
+	{
+	case BLIT_AUTO:
+		active = bestKernels();
+		return (true);
+	case BLIT_SCALAR:
+		active = &scalarKernels;
+		return (true);
+#ifdef BLIT_X86
+	case BLIT_SSE2:
+		active = &sse2Kernels;
+		return (true);
+	case BLIT_AVX2:
+		if (!__builtin_cpu_supports("avx2"))
+			return (false);
+		active = &avx2Kernels;
+		return (true);
+#endif
+	default:
+		return (false);
+	}
+}
+
+const char *blitKernelName(void)
+{
+	return (kernels()->name);
+}
+
+enum blitKernel blitKernelInUse(void)
+{
+	return (kernels()->kernel);
+}
+
+void blitCopy(char *dst, const char *src, int len)
+{
+	kernels()->copy(dst, src, len);
+}
+
+void blitMasked(char *dst, const char *src, int len)
+{
+	kernels()->masked(dst, src, len);
+}
+
+void blitFill(char *dst, char cell, int len)
+{
+	kernels()->fill(dst, cell, len);
+}
@@ -0,0 +1,43 @@
+/**********************************************************************
+  Module: blit.h
+
+  Purpose: Copy and fill kernels for rows of console cells, in SSE2 and
+	   AVX2 with a scalar fallback.
+
+  NOTES: console.c moves every cell it draws through these. The best
+	 kernel the CPU has is picked on first use; blitSelect can force
+	 another one, which is how the benchmarks compare them. Rows are
+	 short (a sprite row, at most a view row), so the vector kernels
+	 finish with one overlapping unaligned store instead of a scalar
+	 tail.
+**********************************************************************/
+
+#ifndef BLIT_H
+#define BLIT_H
+
+#include <stdbool.h>
+
+enum blitKernel {BLIT_AUTO, BLIT_SCALAR, BLIT_SSE2, BLIT_AVX2};
+
+/* Makes every later blit use `kernel'. Returns false, and keeps the current
+   one, if this CPU or build can't run it. */
+extern bool blitSelect(enum blitKernel kernel);
+
+/* Name of the kernel in use, for benchmark output */
+extern const char *blitKernelName(void);
+
+/* The kernel in use, never BLIT_AUTO. Other kernel sets, like logmotion.c,
+   follow it so one blitSelect picks the instruction set for all of them */
+extern enum blitKernel blitKernelInUse(void);
+
+/* Copies `len' cells */
+extern void blitCopy(char *dst, const char *src, int len);
+
+/* Copies `len' cells, except that spaces in `src' are transparent and leave
+   what is already in `dst', so overlapping sprites don't erase each other */
+extern void blitMasked(char *dst, const char *src, int len);
+
+/* Sets `len' cells to `cell' */
+extern void blitFill(char *dst, char cell, int len);
+
+#endif /* BLIT_H */
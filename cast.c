@@ -0,0 +1,257 @@
+/**********************************************************************
+  Module: cast.c
+
+  Purpose: asciicast v2 recorder for console.c. see cast.h
+
+  NOTES: the ring holds rows, not frames, so a frame costs only the
+	 rows that changed. The producer fills the slots past head and
+	 publishes the whole frame with one release store; the writer
+	 reads up to head and gives the slots back with a release store
+	 of tail. The writer polls, so the producer never has to wake it.
+**********************************************************************/
+
+#include "cast.h"
+#include "console.h"
+#include "session.h"
+#include "threadwrappers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define CAST_SLOTS 1024		/* rows the ring holds, a power of two */
+#define CAST_MAX_WIDTH 256	/* wider rows are cut, the view is narrower */
+#define CAST_POLL_TICKS 5	/* how long the writer sleeps on an empty ring */
+#define ESCAPED_CELL 6		/* longest escape of one cell, "\u001b" */
+#define MOVE_LEN 16		/* "\u001b[rrrr;1H" */
+
+typedef struct CAST_SLOT CastSlot;
+struct CAST_SLOT {
+	unsigned long tick;	/* only set on the last row of a frame */
+	short row, width, height;
+	bool endOfFrame;
+	char cells[CAST_MAX_WIDTH];
+};
+
+typedef struct CAST_STATE CastState;
+struct CAST_STATE {
+	CastSlot ring[CAST_SLOTS];
+	atomic_ulong head;	/* next slot the producer publishes */
+	atomic_ulong tail;	/* next slot the writer reads */
+	ShutdownToken stop;	/* cancelled by castStop, wakes the writer */
+
+	/* producer side, only touched under the compositor's publish lock */
+	unsigned long frameEnd;	/* head plus the rows of the frame being built */
+	int frameHeight;
+	bool needFull;
+	long framesDropped;
+
+	/* writer side */
+	FILE *file;
+	pthread_t writer;
+	bool headerWritten;
+	char *event;		/* output of the frame being formatted */
+	size_t eventLen, eventSize;
+	long framesWritten;
+};
+
+/* Local functions */
+
+static CastState *castState(void)
+{
+	return currentSession()->cast;
+}
+
+static void appendEvent(CastState *c, const char *bytes, size_t len)
+{
+	char *grown;
+
+	if (c->eventLen + len > c->eventSize)
+	{
+		grown = realloc(c->event, 2 * (c->eventLen + len));
+		if (grown == NULL)
+			return;	/* the frame is cut short rather than lost */
+		c->event = grown;
+		c->eventSize = 2 * (c->eventLen + len);
+	}
+	memcpy(c->event + c->eventLen, bytes, len);
+	c->eventLen += len;
+}
+
+/* Cursor move plus the row's cells, escaped for a JSON string */
+static void formatRow(CastState *c, CastSlot *slot)
+{
+	char escaped[MOVE_LEN + CAST_MAX_WIDTH * ESCAPED_CELL + 1];
+	int len, i;
+	unsigned char cell;
+
+	len = snprintf(escaped, MOVE_LEN, "\\u001b[%d;1H", slot->row + 1);
+	for (i = 0; i < slot->width; i++)
+	{
+		cell = slot->cells[i];
+		if (cell == '"' || cell == '\\')
+		{
+			escaped[len++] = '\\';
+			escaped[len++] = cell;
+		}
+		else if (cell < 0x20)
+			len += snprintf(escaped + len, ESCAPED_CELL + 1, "\\u%04x", cell);
+		else if (cell >= 0x7f)
+			escaped[len++] = '?';	/* the cast is utf-8, the board is ascii */
+		else
+			escaped[len++] = cell;
+	}
+	appendEvent(c, escaped, len);
+}
+
+static void writeHeader(CastState *c, CastSlot *slot)
+{
+	fprintf(c->file, "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %ld, "
+		"\"env\": {\"TERM\": \"xterm-256color\"}}\n",
+		slot->width, slot->height, (long)time(NULL));
+	fprintf(c->file, "[0.000, \"o\", \"\\u001b[2J\\u001b[?25l\"]\n");
+	c->headerWritten = true;
+}
+
+/* Formats and writes every frame the producer has published so far */
+static void drainRing(CastState *c)
+{
+	unsigned long head = atomic_load_explicit(&c->head, memory_order_acquire);
+	unsigned long tail = atomic_load_explicit(&c->tail, memory_order_relaxed);
+	CastSlot *slot;
+
+	while (tail != head)
+	{
+		slot = &c->ring[tail % CAST_SLOTS];
+		if (!c->headerWritten)
+			writeHeader(c, slot);
+		formatRow(c, slot);
+		if (slot->endOfFrame)
+		{
+			fprintf(c->file, "[%.3f, \"o\", \"", tickSeconds(slot->tick));
+			fwrite(c->event, 1, c->eventLen, c->file);
+			fprintf(c->file, "\"]\n");
+			c->eventLen = 0;
+			c->framesWritten++;
+		}
+		tail++;
+		atomic_store_explicit(&c->tail, tail, memory_order_release);
+	}
+}
+
+static void *castWriter(void *arg)
+{
+	CastState *c = (CastState *)arg;
+	bool stopping;
+
+	do
+	{
+		stopping = shutdownRequested(&c->stop);
+		drainRing(c);	/* after stopping is seen, this gets the last frames */
+		if (!stopping)
+			sleepTicksOn(&c->stop, CAST_POLL_TICKS);
+	} while (!stopping);
+	pthread_exit(NULL);
+}
+
+/********************** Interface functions ***********************/
+
+bool castStart(const char *path)
+{
+	CastState *c = calloc(1, sizeof(CastState));
+
+	if (c == NULL)
+		return (false);
+	c->file = fopen(path, "w");
+	if (c->file == NULL)
+	{
+		free(c);
+		return (false);
+	}
+	c->needFull = true;	/* a cast starts from a blank screen */
+	shutdownInit(&c->stop);
+	currentSession()->cast = c;
+	createThread(&c->writer, castWriter, c);
+	return (true);
+}
+
+void castStop(void)
+{
+	CastState *c = castState();
+
+	if (c == NULL)
+		return;
+	shutdownCancel(&c->stop);
+	joinThread(c->writer);
+	shutdownDestroy(&c->stop);
+	fclose(c->file);
+	fprintf(stderr, "cast: %ld frames recorded, %ld dropped\n", c->framesWritten, c->framesDropped);
+	free(c->event);
+	free(c);
+	currentSession()->cast = NULL;
+}
+
+bool castBeginFrame(int rows, bool *full)
+{
+	CastState *c = castState();
+	unsigned long head;
+
+	if (c == NULL)
+		return (false);
+	head = atomic_load_explicit(&c->head, memory_order_relaxed);
+	if (head + rows - atomic_load_explicit(&c->tail, memory_order_acquire) > CAST_SLOTS)
+	{
+		c->framesDropped++;
+		c->needFull = true;	/* the rows this frame changed are lost otherwise */
+		return (false);
+	}
+	c->frameEnd = head;
+	c->frameHeight = rows;
+	*full = c->needFull;
+	return (true);
+}
+
+bool castFinalFrame(int rows)
+{
+	CastState *c = castState();
+	bool full = false;
+
+	if (c == NULL || !c->needFull)
+		return (false);
+	while (!castBeginFrame(rows, &full))
+	{
+		c->framesDropped--;	/* only waiting, nothing is lost */
+		sleepTicksOn(&c->stop, CAST_POLL_TICKS);	/* the game may be over, its own sleeps no longer wait */
+	}
+	return (true);
+}
+
+void castRow(int row, const char *cells, int width)
+{
+	CastState *c = castState();
+	CastSlot *slot = &c->ring[c->frameEnd % CAST_SLOTS];
+
+	slot->row = row;
+	slot->width = width < CAST_MAX_WIDTH ? width : CAST_MAX_WIDTH;
+	slot->height = c->frameHeight;
+	slot->endOfFrame = false;
+	memcpy(slot->cells, cells, slot->width);
+	c->frameEnd++;
+}
+
+void castEndFrame(unsigned long tick)
+{
+	CastState *c = castState();
+	CastSlot *last;
+
+	if (c->frameEnd == atomic_load_explicit(&c->head, memory_order_relaxed))
+		return;	/* nothing changed */
+	last = &c->ring[(c->frameEnd - 1) % CAST_SLOTS];
+	last->endOfFrame = true;
+	last->tick = tick;
+	c->needFull = false;
+	atomic_store_explicit(&c->head, c->frameEnd, memory_order_release);
+}
@@ -0,0 +1,50 @@
+/**********************************************************************
+  Module: cast.h
+
+  Purpose: Records what a session's console shows as an asciicast v2
+	   file, so a game can be watched again with any asciicast
+	   player.
+
+  NOTES: the compositor hands every published row to the recorder
+	 while it holds its publish lock, which makes it the single
+	 producer of a lock-free ring. A writer thread is the single
+	 consumer and does all the formatting and file writes. When the
+	 ring is full the whole frame is dropped and counted, the game
+	 never waits on the disk, and the next frame that fits is
+	 recorded in full so the cast doesn't lose what was dropped.
+	 Events are stamped with game time from the tick clock, not wall
+	 time, so a fast replay still records a real time cast.
+**********************************************************************/
+
+#ifndef CAST_H
+#define CAST_H
+
+#include <stdbool.h>
+
+/* Starts recording the current session's console to `path'. Returns false
+   if the file can't be created. */
+extern bool castStart(const char *path);
+
+/* Writes out every frame still queued, closes the file and prints how many
+   frames were recorded and dropped. Does nothing if not recording. */
+extern void castStop(void);
+
+/* Called by the compositor before it publishes a frame of at most `rows'
+   rows. Returns false if the frame isn't recorded, either because nothing
+   is recording or because the ring is full. `full' is set if every row has
+   to be recorded, not just the changed ones. */
+extern bool castBeginFrame(int rows, bool *full);
+
+/* Called when the console is finished. If the last frames were dropped,
+   waits for room (the game is over by then) and returns true, and the
+   caller records the screen in full one more time with castRow and
+   castEndFrame. */
+extern bool castFinalFrame(int rows);
+
+/* Adds one row of the frame begun by castBeginFrame */
+extern void castRow(int row, const char *cells, int width);
+
+/* Hands the frame to the writer, stamped with game tick `tick' */
+extern void castEndFrame(unsigned long tick);
+
+#endif /* CAST_H */
@@ -12,142 +12,518 @@
 **********************************************************************/
 
 #include "console.h"
-#include <curses.h>
+#include "consolebackend.h"
+#include "session.h"
+#include "cast.h"
+#include "blit.h"
+#include "trace.h"
+#include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <time.h>        /*for nano sleep */
 #include <stdbool.h>
+#include <sched.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 
-static int CON_WIDTH, CON_HEIGHT;
-static int consoleLock = false;
 static int MAX_STR_LEN = 256; /* for strlen checking */
 
+/* Everything one session's console needs. The framebuffer game threads draw
+   into has a lock per row so threads drawing on different rows never wait on
+   each other, and a generation stamp per row so the compositor only publishes
+   rows that changed. Behind it is the whole board: draw calls take board
+   coordinates and the view's top left corner is subtracted before they land
+   in the framebuffer, so anything outside the view costs nothing but the
+   clip. Strings put on the board are kept in the background so they come back
+   when the view scrolls. */
+typedef struct CONSOLE_STATE ConsoleState;
+struct CONSOLE_STATE {
+	int CON_WIDTH, CON_HEIGHT;	/* the view, what the backend shows */
+	int WORLD_WIDTH, WORLD_HEIGHT;
+	int consoleLock;
+	bool unrendered;	/* the null console, nothing is drawn */
+	ConsoleBackend *backend;
+
+	char *frameBuffer;
+	pthread_mutex_t *rowLocks;
+	unsigned long *rowGeneration;
+	atomic_ulong dirtyGeneration;
+	atomic_int activeWriters;
+	atomic_long cellsWritten;
+	atomic_long framesPublished;
+
+	char *background;
+	int viewTop, viewLeft;
+	pthread_mutex_t backgroundLock;
+
+	/* Compositor state, only touched while holding publishLock */
+	pthread_mutex_t publishLock;
+	unsigned long publishedGeneration;
+	struct timespec lastPublish;
+};
+
+#define MAX_FPS 60
+#define NSEC_PER_SEC 1000000000L
+#define MAX_WRITER_WAITS 64 /* yields before a busy frame is skipped */
+
 /* Local functions */
 
-static bool checkConsoleSize(int reqHeight, int reqWidth) 
+static ConsoleState *state(void)
+{
+	return currentSession()->console;
+}
+
+/* The session's console is made by whichever of consoleSelectBackend and
+   consoleInit is called first, with curses as the backend */
+static ConsoleState *ensureState(void)
+{
+	ConsoleState *c = state();
+
+	if (c == NULL)
+	{
+		c = calloc(1, sizeof(ConsoleState));
+		if (c == NULL)
+			return (NULL);
+		c->backend = &cursesBackend;
+		pthread_mutex_init(&c->backgroundLock, NULL);
+		pthread_mutex_init(&c->publishLock, NULL);
+		currentSession()->console = c;
+	}
+	return (c);
+}
+
+static bool createFrameBuffer(ConsoleState *c, int height, int width)
+{
+	int i;
+
+	c->frameBuffer = malloc((size_t)height * width);
+	c->rowLocks = malloc(sizeof(pthread_mutex_t) * height);
+	c->rowGeneration = calloc(height, sizeof(unsigned long));
+	if (c->frameBuffer == NULL || c->rowLocks == NULL || c->rowGeneration == NULL)
+		return (false);
+
+	memset(c->frameBuffer, ' ', (size_t)height * width);
+	for (i = 0; i < height; i++)
+		pthread_mutex_init(&c->rowLocks[i], NULL);
+
+	return (true);
+}
+
+static void destroyFrameBuffer(ConsoleState *c)
+{
+	int i;
+
+	if (c->rowLocks != NULL)
+		for (i = 0; i < c->CON_HEIGHT; i++)
+			pthread_mutex_destroy(&c->rowLocks[i]);
+	free(c->frameBuffer);
+	free(c->rowLocks);
+	free(c->rowGeneration);
+	free(c->background);
+	c->background = NULL;
+	c->frameBuffer = NULL;
+	c->rowLocks = NULL;
+	c->rowGeneration = NULL;
+}
+
+/* Writes `len' chars of `str' into framebuffer row `row' starting at `col'.
+   Caller has already clipped to the console. */
+static void writeRow(ConsoleState *c, int row, int col, const char *str, int len, bool transparent)
+{
+	char *cells = c->frameBuffer + (size_t)row*c->CON_WIDTH + col;
+
+	pthread_mutex_lock(&c->rowLocks[row]);
+	if (str == NULL)
+		blitFill(cells, ' ', len);
+	else if (transparent)
+		blitMasked(cells, str, len);
+	else
+		blitCopy(cells, str, len);
+	c->rowGeneration[row] = atomic_fetch_add(&c->dirtyGeneration, 1) + 1;
+	pthread_mutex_unlock(&c->rowLocks[row]);
+	atomic_fetch_add(&c->cellsWritten, len);
+}
+
+/* Copies the background under the view into the framebuffer. Anything drawn
+   over it has to be drawn again. Caller holds backgroundLock. */
+static void repaintView(ConsoleState *c)
+{
+	int i;
+
+	for (i = 0; i < c->CON_HEIGHT; i++)
+		writeRow(c, i, 0, c->background + (size_t)(c->viewTop+i)*c->WORLD_WIDTH + c->viewLeft, c->CON_WIDTH, false);
+}
+
+static long elapsedNsec(struct timespec *from, struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) * NSEC_PER_SEC + (to->tv_nsec - from->tv_nsec);
+}
+
+/* Hands every row that changed since the last publish to the backend and
+   presents the frame. Skips the frame if nothing moved, if it is too soon after the
+   last one (unless `force'), or if writers stay busy. */
+static void publishFrame(ConsoleState *c, bool force)
 {
+	struct timespec now;
+	unsigned long generation;
+	bool recording, fullFrame, changed;
+	const char *row;
+	int waits, i;
+
+	if (c->unrendered)
+		return;
+	pthread_mutex_lock(&c->publishLock);
+	generation = atomic_load(&c->dirtyGeneration);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (c->consoleLock || generation == c->publishedGeneration ||
+	    (!force && elapsedNsec(&c->lastPublish, &now) < NSEC_PER_SEC / MAX_FPS))
+	{
+		pthread_mutex_unlock(&c->publishLock);
+		return;
+	}
+
+	/* let half finished clear+draw pairs land so the frame isn't torn */
+	for (waits = 0; atomic_load(&c->activeWriters) > 0 && waits < MAX_WRITER_WAITS; waits++)
+		sched_yield();
+	if (atomic_load(&c->activeWriters) > 0 && !force)
+	{
+		pthread_mutex_unlock(&c->publishLock);
+		return;
+	}
 
-	if ( (reqWidth > COLS) || (reqHeight > LINES) ) 
- 	{
-    		fprintf(stderr, "\n\n\rSorry, your window is only %ix%i. \n\r%ix%i is required. Sorry.\n\r", COLS, LINES, reqWidth, reqHeight);
-    		return (false);
-  	}
+	generation = atomic_load(&c->dirtyGeneration);
+	recording = castBeginFrame(c->CON_HEIGHT, &fullFrame);
+	for (i = 0; i < c->CON_HEIGHT; i++)
+	{
+		row = c->frameBuffer + (size_t)i*c->CON_WIDTH;
+		pthread_mutex_lock(&c->rowLocks[i]);
+		changed = c->rowGeneration[i] > c->publishedGeneration;
+		if (changed)
+			c->backend->drawRow(i, row, c->CON_WIDTH);
+		if (recording && (changed || fullFrame))
+			castRow(i, row, c->CON_WIDTH);
+		pthread_mutex_unlock(&c->rowLocks[i]);
+	}
+	c->backend->present();
+	if (recording)
+		castEndFrame(currentSession()->tick);
+	atomic_fetch_add(&c->framesPublished, 1);
+
+	c->publishedGeneration = generation;
+	c->lastPublish = now;
+	pthread_mutex_unlock(&c->publishLock);
+}
 
-  return(true);
+void consoleSelectBackend(enum consoleBackendType type, const char *dumpPath)
+{
+	ConsoleState *c = ensureState();
+	c->unrendered = type == NULL_CONSOLE;	/* keeps whatever backend it had, it is never called */
+	if (type == HEADLESS_CONSOLE)
+	{
+		c->backend = &headlessBackend;
+		headlessDumpFrames(dumpPath);
+	}
+	else if (type == PTY_CONSOLE)
+		c->backend = &ptyBackend;
+	else if (type == CURSES_CONSOLE)
+		c->backend = &cursesBackend;
 }
 
 bool consoleInit(int height, int width, char *image[])  /* assumes image height/width is same as height param */
 {
-	bool status;
+	return consoleInitView(height, width, height, width, image);
+}
 
-	initscr();
-	crmode();
-	noecho();
-	clear();
+bool consoleInitView(int worldHeight, int worldWidth, int viewHeight, int viewWidth, char *image[])
+{
+	ConsoleState *c = ensureState();
+	bool status;
+	int i, length;
 
-	CON_HEIGHT = height;  CON_WIDTH = width;
-	status = checkConsoleSize(CON_HEIGHT, CON_WIDTH);
+	if (c == NULL)
+		return (false);
+	c->CON_HEIGHT = viewHeight;  c->CON_WIDTH = viewWidth;
+	c->WORLD_HEIGHT = worldHeight;  c->WORLD_WIDTH = worldWidth;
+	c->viewTop = c->viewLeft = 0;
+	c->consoleLock = 0;
+	if (c->unrendered)
+		return (true);
+	status = c->backend->init(c->CON_HEIGHT, c->CON_WIDTH) && createFrameBuffer(c, c->CON_HEIGHT, c->CON_WIDTH);
+	if (status)
+	{
+		c->background = malloc((size_t)c->WORLD_HEIGHT * c->WORLD_WIDTH);
+		status = c->background != NULL;
+	}
 
 	if (status) 
 	{
-		consoleDrawImage(0, 0, image, CON_HEIGHT);
-		consoleRefresh();
+		memset(c->background, ' ', (size_t)c->WORLD_HEIGHT * c->WORLD_WIDTH);
+		for (i = 0; i < c->WORLD_HEIGHT; i++)
+		{
+			length = strnlen(image[i], c->WORLD_WIDTH);
+			memcpy(c->background + (size_t)i*c->WORLD_WIDTH, image[i], length);
+		}
+		pthread_mutex_lock(&c->backgroundLock);
+		repaintView(c);
+		pthread_mutex_unlock(&c->backgroundLock);
+		publishFrame(c, true);
 	}
 
 	return(status);
 }
 
-void consoleDrawImage(int row, int col, char *image[], int height) 
+bool consoleSetViewport(int top, int left)
 {
-	int i, length;
-	int newLeft, newRight, newOffset, newLength;
+	ConsoleState *c = state();
+	bool moved;
+
+	if (top > c->WORLD_HEIGHT - c->CON_HEIGHT) top = c->WORLD_HEIGHT - c->CON_HEIGHT;
+	if (left > c->WORLD_WIDTH - c->CON_WIDTH) left = c->WORLD_WIDTH - c->CON_WIDTH;
+	if (top < 0) top = 0;
+	if (left < 0) left = 0;
+
+	pthread_mutex_lock(&c->backgroundLock);
+	moved = top != c->viewTop || left != c->viewLeft;
+	if (moved)
+	{
+		c->viewTop = top;
+		c->viewLeft = left;
+		if (!c->unrendered)
+			repaintView(c);
+	}
+	pthread_mutex_unlock(&c->backgroundLock);
 
-	if (consoleLock) return;
+	return(moved);
+}
 
-	newLeft  = col < 0 ? 0 : col;
-	newOffset = col < 0 ? -col : 0;
+void consoleViewport(int *top, int *left, int *height, int *width)
+{
+	ConsoleState *c = state();
+	*top = c->viewTop;
+	*left = c->viewLeft;
+	*height = c->CON_HEIGHT;
+	*width = c->CON_WIDTH;
+}
 
-	for (i = 0; i < height; i++) 
+bool consoleInView(int row, int col, int height, int width)
+{
+	ConsoleState *c = state();
+	return !c->unrendered && row + height > c->viewTop && row < c->viewTop + c->CON_HEIGHT &&
+	       col + width > c->viewLeft && col < c->viewLeft + c->CON_WIDTH;
+}
+
+void consoleBeginUpdate(void)
+{
+	ConsoleState *c = state();
+	atomic_fetch_add(&c->activeWriters, 1);
+}
+
+void consoleEndUpdate(void)
+{
+	ConsoleState *c = state();
+	atomic_fetch_sub(&c->activeWriters, 1);
+}
+
+/* Clips the sprite against the view once: rows outside it are never looked
+   at, and every row shares the same visible columns. A transparent draw
+   only copies the part of each row between its first and last non blank
+   cell, and only blends the rows with blanks inside that */
+static void drawImage(ConsoleState *c, int row, int col, const Sprite *sprite, int frame, bool transparent)
+{
+	const SpriteRow *cells;
+	int i, first, last, left, right, from, to;
+
+	if (c->consoleLock || c->unrendered) return;
+
+	row -= c->viewTop;  col -= c->viewLeft;	/* board to view coordinates */
+	first = row < 0 ? -row : 0;
+	last = row+sprite->height > c->CON_HEIGHT ? c->CON_HEIGHT-row : sprite->height;
+	left = col < 0 ? 0 : col;
+	right = col+sprite->width > c->CON_WIDTH ? c->CON_WIDTH : col+sprite->width;
+	if (first >= last || left >= right)
+		return;
+
+	consoleBeginUpdate();
+	for (i = first; i < last; i++) 
 	{
-		if (row+i < 0 || row+i >= CON_HEIGHT)
-			continue;
-		length = strnlen(image[i], MAX_STR_LEN);
-		newRight = col+length >= CON_WIDTH ? CON_WIDTH-1 : col+length;
-		newLength = newRight - newLeft + 1;
-		if (newOffset >= length || newLength <= 0)
-		  continue;
-
-		if (mvaddnstr(row+i, newLeft, image[i]+newOffset, newLength) == ERR)
-			fprintf(stderr, "ERROR drawing to screen"); /* smarter handling is needed */
+		cells = SPRITE_ROW(sprite, frame, i);
+		from = left;  to = right;
+		if (transparent)
+		{
+			from = col+cells->first > left ? col+cells->first : left;
+			to = col+cells->first+cells->length < right ? col+cells->first+cells->length : right;
+			if (from >= to)
+				continue;
+		}
+		writeRow(c, row+i, from, cells->cells + (from-col), to-from, transparent && !cells->solid);
 	}
+	consoleEndUpdate();
+}
+
+void consoleDrawImage(int row, int col, const Sprite *sprite, int frame) 
+{
+	drawImage(state(), row, col, sprite, frame, false);
+}
+
+void consoleDrawSprite(int row, int col, const Sprite *sprite, int frame) 
+{
+	drawImage(state(), row, col, sprite, frame, true);
 }
 
 void consoleClearImage(int row, int col, int height, int width) 
 {
-	int i, j;
-	if (consoleLock) return;
+	ConsoleState *c = state();
+	int i;
+	if (c->consoleLock || c->unrendered) return;
 
-	if (col+width > CON_WIDTH)
-		width = CON_WIDTH-col;
+	row -= c->viewTop;  col -= c->viewLeft;	/* board to view coordinates */
+	if (col+width > c->CON_WIDTH)
+		width = c->CON_WIDTH-col;
 	if (col < 0) 
 	{
 		width += col; /* -= -col */
 		col = 0;
 	}
 
-	if (width < 1 || col >= CON_WIDTH) /* nothing to clear */
+	if (width < 1 || col >= c->CON_WIDTH) /* nothing to clear */
 		return;
 
+	consoleBeginUpdate();
 	for (i = 0; i < height; i++) 
 	{
-		if (row+i < 0 || row+i >= CON_HEIGHT)
+		if (row+i < 0 || row+i >= c->CON_HEIGHT)
 			continue;
-		move(row+i, col);
-		for (j = 0; j < width; j++)
-	    		addch(' ');
+		writeRow(c, row+i, col, NULL, width, false);
 	}
+	consoleEndUpdate();
 }
 
 void consoleRefresh(void)
 {
-	if (!consoleLock) 
+	ConsoleState *c = state();
+	traceBegin("consoleRefresh");
+	publishFrame(c, false);
+	traceEnd();
+}
+
+void consoleFinish(void) 
+{
+	ConsoleState *c = state();
+	int i;
+
+	if (c->unrendered)
+		return;
+	if (castFinalFrame(c->CON_HEIGHT))	/* put back what a slow disk dropped */
 	{
-	    move(LINES-1, COLS-1);
-	    refresh();
+		for (i = 0; i < c->CON_HEIGHT; i++)
+			castRow(i, c->frameBuffer + (size_t)i*c->CON_WIDTH, c->CON_WIDTH);
+		castEndFrame(currentSession()->tick);
 	}
+    c->backend->finish();
+    destroyFrameBuffer(c);
 }
 
-void consoleFinish(void) 
+void consoleFree(void)
+{
+	ConsoleState *c = state();
+
+	if (c == NULL)
+		return;
+	pthread_mutex_destroy(&c->backgroundLock);
+	pthread_mutex_destroy(&c->publishLock);
+	free(c);
+	currentSession()->console = NULL;
+}
+
+unsigned long consoleChecksum(void)
+{
+	ConsoleState *c = state();
+	unsigned long hash = 2166136261UL; /* FNV-1a */
+	int i, j;
+
+	for (i = 0; i < c->CON_HEIGHT && !c->unrendered; i++)
+	{
+		pthread_mutex_lock(&c->rowLocks[i]);
+		for (j = 0; j < c->CON_WIDTH; j++)
+			hash = ((hash ^ (unsigned char)c->frameBuffer[(size_t)i*c->CON_WIDTH + j]) * 16777619UL) & 0xffffffffUL;
+		pthread_mutex_unlock(&c->rowLocks[i]);
+	}
+	return hash;
+}
+
+long consoleCellsWritten(void)
+{
+	ConsoleState *c = state();
+    return atomic_load(&c->cellsWritten);
+}
+
+long consoleFramesPublished(void)
 {
-    endwin();
+	ConsoleState *c = state();
+    return atomic_load(&c->framesPublished);
 }
 
 void putBanner(const char *str) 
 {
-  if (consoleLock) return;
+  ConsoleState *c = state();
+  if (c->consoleLock || c->unrendered) return;
   int len;
 
   len = strnlen(str,MAX_STR_LEN);
   
-  move (CON_HEIGHT/2, (CON_WIDTH-len)/2);
-  addnstr(str, len);
-
-  consoleRefresh();
+  putString((char *)str, c->viewTop + c->CON_HEIGHT/2, c->viewLeft + (c->CON_WIDTH-len)/2, len);
+  publishFrame(c, true);
 }
 
 void putString(char *str, int row, int col, int maxlen) 
 {
-  if (consoleLock) return;
-  move(row, col);
-  addnstr(str, maxlen);
+  ConsoleState *c = state();
+  if (c->consoleLock || c->unrendered) return;
+  int len;
+
+  if (row < 0 || row >= c->WORLD_HEIGHT || col < 0 || col >= c->WORLD_WIDTH)
+    return;
+  len = strnlen(str, maxlen);
+  if (col+len > c->WORLD_WIDTH)
+    len = c->WORLD_WIDTH-col;
+
+  /* kept in the background so it survives the view scrolling away and back */
+  pthread_mutex_lock(&c->backgroundLock);
+  memcpy(c->background + (size_t)row*c->WORLD_WIDTH + col, str, len);
+  row -= c->viewTop;  col -= c->viewLeft;
+  if (col < 0)
+  {
+    str -= col;  len += col;  col = 0;
+  }
+  if (col+len > c->CON_WIDTH)
+    len = c->CON_WIDTH-col;
+  if (row >= 0 && row < c->CON_HEIGHT && len > 0)
+    writeRow(c, row, col, str, len, false);
+  pthread_mutex_unlock(&c->backgroundLock);
 }
 
 
 /* setup to work in USECS, reduces risk of overflow */
 /* 10000 usec = 10 ms, or 100fps */
-#define TIMESLICE_USEC 10000
+#define TICK_USEC 10000
+#define TIMESLICE_USEC (TICK_USEC / tickSpeedup)
 #define TIME_USECS_SIZE 1000000
 #define USEC_TO_NSEC 1000  
+static int tickSpeedup = 1;
+
+void setTickSpeedup(int speedup)
+{
+  /* a tick is never shorter than 1 usec, a 0 length tick would
+     divide by zero in tickClockWait */
+  if (speedup < 1)
+    speedup = 1;
+  else if (speedup > TICK_USEC)
+    speedup = TICK_USEC;
+  tickSpeedup = speedup;
+}
+
 struct timespec getTimeout(int ticks) 
 {
   struct timespec rqtp;
@@ -163,26 +539,140 @@ struct timespec getTimeout(int ticks)
   return rqtp;
 }
 
-void sleepTicks(int ticks) 
+double tickSeconds(unsigned long ticks)
+{
+  return ticks * (TICK_USEC / (double)TIME_USECS_SIZE);
+}
+
+void shutdownInit(ShutdownToken *token)
+{
+  pthread_condattr_t attr;
+
+  pthread_mutex_init(&token->lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);	/* deadlines don't jump with the wall clock */
+  pthread_cond_init(&token->wake, &attr);
+  pthread_condattr_destroy(&attr);
+  token->cancelled = false;
+}
+
+void shutdownDestroy(ShutdownToken *token)
+{
+  pthread_cond_destroy(&token->wake);
+  pthread_mutex_destroy(&token->lock);
+}
+
+void shutdownCancel(ShutdownToken *token)
+{
+  pthread_mutex_lock(&token->lock);
+  token->cancelled = true;
+  pthread_cond_broadcast(&token->wake);
+  pthread_mutex_unlock(&token->lock);
+}
+
+void shutdownReset(ShutdownToken *token)
+{
+  pthread_mutex_lock(&token->lock);
+  token->cancelled = false;
+  pthread_mutex_unlock(&token->lock);
+}
+
+bool shutdownRequested(ShutdownToken *token)
+{
+  bool cancelled;
+
+  pthread_mutex_lock(&token->lock);
+  cancelled = token->cancelled;
+  pthread_mutex_unlock(&token->lock);
+  return (cancelled);
+}
+
+bool waitUntil(ShutdownToken *token, const struct timespec *deadline)
+{
+  bool cancelled;
+
+  pthread_mutex_lock(&token->lock);
+  while (!token->cancelled && pthread_cond_timedwait(&token->wake, &token->lock, deadline) != ETIMEDOUT)
+    ;	/* spurious wakeups go back to sleep */
+  cancelled = token->cancelled;
+  pthread_mutex_unlock(&token->lock);
+  return (!cancelled);
+}
+
+/* `ticks' ticks from now on the monotonic clock */
+static struct timespec deadlineIn(int ticks)
+{
+  struct timespec wait = getTimeout(ticks);
+  struct timespec deadline;
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += wait.tv_sec;
+  deadline.tv_nsec += wait.tv_nsec;
+  if (deadline.tv_nsec >= NSEC_PER_SEC)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= NSEC_PER_SEC;
+  }
+  return (deadline);
+}
+
+bool sleepTicksOn(ShutdownToken *token, int ticks)
 {
+  struct timespec deadline;
 
   if (ticks <= 0)
-    return;
+    return (!shutdownRequested(token));
+  deadline = deadlineIn(ticks);
+  return (waitUntil(token, &deadline));
+}
 
-  struct timespec rqtp = getTimeout(ticks);
-  nanosleep(&rqtp, NULL);
+void tickClockStart(TickClock *clock, ShutdownToken *token)
+{
+  clock->next = deadlineIn(1);
+  clock->token = token;
+}
+
+#define MAX_CATCHUP_TICKS 10
+int tickClockWait(TickClock *clock)
+{
+  struct timespec tick = getTimeout(1);
+  long tickNsec = tick.tv_sec * NSEC_PER_SEC + tick.tv_nsec;
+  long late, next;
+  struct timespec now;
+  int due;
+
+  if (!waitUntil(clock->token, &clock->next))
+    return (0);
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  late = elapsedNsec(&clock->next, &now);
+  due = 1 + (late > 0 ? late / tickNsec : 0);
+  if (due > MAX_CATCHUP_TICKS)
+  {
+    /* too far behind to catch up, the rest is dropped and the clock
+       starts again from now */
+    due = MAX_CATCHUP_TICKS;
+    clock->next = now;
+    next = clock->next.tv_nsec + tickNsec;
+  }
+  else
+    next = clock->next.tv_nsec + due * tickNsec;
+  clock->next.tv_sec += next / NSEC_PER_SEC;
+  clock->next.tv_nsec = next % NSEC_PER_SEC;
+  return (due);
 }
 
 #define FINAL_PAUSE 2 
 void finalKeypress() 
 {
-	flushinp();
-	sleepTicks(FINAL_PAUSE);
-    	move(LINES-1, COLS-1);
-	getch(); /* wait for user to press a character, blocking. */
+	ConsoleState *c = state();
+	struct timespec pause = getTimeout(FINAL_PAUSE);
+
+	nanosleep(&pause, NULL);	/* not sleepTicksOn, the game is over so its token is already cancelled */
+	c->backend->waitForKey();
 }
 
 void disableConsole(int disabled) 
 {
-	consoleLock = disabled;
+	ConsoleState *c = state();
+	c->consoleLock = disabled;
 }
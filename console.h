@@ -8,14 +8,21 @@
   Changes: 
     2017 May 3 [ Jim Young ]
 
-  NOTES: none of these functions are re-entrant (they are not thread
-	 		safe)
+  NOTES: drawing goes to an in-memory framebuffer with a lock per row, so
+	 		the draw functions can be called from any thread. Only the
+			compositor (consoleRefresh) talks to the backend, which is
+			curses unless the headless one is selected. Every session has
+			its own console; the functions work on the calling thread's
+			current session.
 **********************************************************************/
 
 #ifndef CONSOLE_H
 #define CONSOLE_H
 
 #include <stdbool.h>
+#include "sprite.h"
+#include <time.h>
+#include <pthread.h>
 
 /**************** DRAWING **************************/
 
@@ -28,26 +35,65 @@
 #define SCR_LEFT 0
 #define SCR_TOP 0
 
+enum consoleBackendType {CURSES_CONSOLE, HEADLESS_CONSOLE, PTY_CONSOLE, NULL_CONSOLE};
+
+/* Picks where the current session's frames go. Call before consoleInit;
+   curses is the default. The headless backend needs no terminal and appends
+   every published frame to `dumpPath' if it isn't NULL. The pty backend
+   writes only the cells that changed as plain ANSI sequences, to the
+   session's own terminal or, for the local session, to stdout. The null
+   console keeps the board's size and view but has no framebuffer at all:
+   nothing is in view, every draw returns at once and no frame is ever
+   published, for games nobody looks at. */
+extern void consoleSelectBackend(enum consoleBackendType type, const char *dumpPath);
+
 /* Initialize curses, draw initial gamescreen. Refreshes console to terminal. 
  Also stores the requested dimensions of the consoe and tests the terminal for the
  given dimensions.*/
 extern bool consoleInit(int reqHeight, int reqWidth, char *image[]);
 
-/* Draws 2d `image' of `height' rows, at curses coordinates `(row, col)'.
-   Note: parts of the `image' falling on negative rows are not drawn; each
-   row drawn is clipped on the left and right side of the game console (note
-   that `col' may be negative, indicating `image' starts to the left of the
-   screen and will thus only be partially drawn. Useful for objects that are
-   half off the screen  */
-extern void consoleDrawImage(int row, int col, char *image[], int height);
+/* Like consoleInit for a board bigger than the screen: `image' is the whole
+   `worldHeight'x`worldWidth' board and only a `viewHeight'x`viewWidth' view of
+   it is shown, starting at the top left corner. All the drawing functions
+   below take board coordinates. */
+extern bool consoleInitView(int worldHeight, int worldWidth, int viewHeight, int viewWidth, char *image[]);
+
+/* Scrolls the view so its top left corner is board coordinate `(top, left)',
+   kept inside the board. Returns true if the view moved, in which case it
+   shows only the board again and everything on top has to be redrawn. */
+extern bool consoleSetViewport(int top, int left);
+
+/* Gets the view's top left corner in board coordinates and its size */
+extern void consoleViewport(int *top, int *left, int *height, int *width);
+
+/* Checks if any of the `height'x`width' rectangle at `(row, col)' is in view */
+extern bool consoleInView(int row, int col, int height, int width);
+
+/* Draws animation frame `frame' of `sprite' at board coordinates
+   `(row, col)'. Note: parts of the sprite falling on negative rows are not
+   drawn; each row drawn is clipped on the left and right side of the game
+   console (note that `col' may be negative, indicating the sprite starts to
+   the left of the screen and will thus only be partially drawn. Useful for
+   objects that are half off the screen  */
+extern void consoleDrawImage(int row, int col, const Sprite *sprite, int frame);
+
+/* Same as consoleDrawImage, but blanks in the sprite are transparent and
+   leave whatever is under them, for sprites that overlap */
+extern void consoleDrawSprite(int row, int col, const Sprite *sprite, int frame);
 
 /* Clears a 2d `width'x`height' rectangle with spaces.  Upper left hand
-   corner is curses coordinate `(row,col)'. */
+   corner is board coordinate `(row,col)'. */
 extern void consoleClearImage(int row, int col, int width, int height);
 
-/* Moves cursor to bottom right corner and refreshes. If this is not done,
-   the curses internal buffer (that you have been drawing to) is not dumped
-   to screen. */
+/* Brackets a group of draws (e.g. a clear followed by a draw) that should
+   show up in the same frame. Writers never block each other; the compositor
+   just holds off publishing while any group is open. */
+extern void consoleBeginUpdate(void);
+extern void consoleEndUpdate(void);
+
+/* Compositor. Publishes the rows of the framebuffer that changed since the
+   last frame to curses and refreshes. Does nothing if no draw happened since
+   the last frame, and never publishes faster than the capped frame rate. */
 extern void consoleRefresh(void);
 
 /*  turns off all updates. Can be used to prevent the screen refresh from working, e.g., at game end while threads are all catching up.*/
@@ -56,14 +102,81 @@ extern void disableConsole(int disabled);
 /* Terminates curses cleanly. */
 extern void consoleFinish(void);
 
-/* Puts the given banner in the center of the screen */
+/* Frees the session's console once it is finished. Its counters last until
+   then, and a finished console can be set up again with consoleInitView. */
+extern void consoleFree(void);
+
+/* Hash of every cell in the framebuffer, for checking two runs drew the same */
+extern unsigned long consoleChecksum(void);
+
+/* Number of cells written into the framebuffer so far */
+extern long consoleCellsWritten(void);
+
+/* Number of frames the compositor has handed to the backend so far */
+extern long consoleFramesPublished(void);
+
+/* Puts the given banner in the center of the view */
 void putBanner(const char *);
 
-/* Draws the given string at the given location  */
+/* Draws the given string at the given board location. It stays on the board
+   when the view scrolls away and back */
 void putString(char *, int row, int col, int maxlen);
 
-/* Sleeps the given number of 10ms ticks */
-void sleepTicks(int ticks);
+/* A shutdown token. Every timed wait of a game is on one, so cancelling it
+   wakes all of them at once instead of leaving threads asleep for the rest
+   of their wait. Each session has one, cancelled when its game ends */
+typedef struct SHUTDOWN_TOKEN ShutdownToken;
+struct SHUTDOWN_TOKEN {
+  pthread_mutex_t lock;
+  pthread_cond_t wake;	/* waits on the monotonic clock */
+  bool cancelled;
+};
+
+/* Sets up a token that isn't cancelled */
+void shutdownInit(ShutdownToken *token);
+
+/* Frees the token. Nobody may be waiting on it */
+void shutdownDestroy(ShutdownToken *token);
+
+/* Cancels the token and wakes everyone waiting on it. Later waits on it
+   return at once until it is reset */
+void shutdownCancel(ShutdownToken *token);
+
+/* Makes a cancelled token usable again, for the next game */
+void shutdownReset(ShutdownToken *token);
+
+/* Checks if the token was cancelled */
+bool shutdownRequested(ShutdownToken *token);
+
+/* Sleeps until `deadline' on the monotonic clock or until the token is
+   cancelled, whichever comes first. Returns false if it was cancelled */
+bool waitUntil(ShutdownToken *token, const struct timespec *deadline);
+
+/* Sleeps the given number of 10ms ticks unless the token is cancelled first.
+   Returns false if it was */
+bool sleepTicksOn(ShutdownToken *token, int ticks);
+
+/* A fixed timestep on the monotonic clock. Every tick is due at an absolute
+   deadline, so time spent between waits and late wakeups don't add up */
+typedef struct TICK_CLOCK TickClock;
+struct TICK_CLOCK {
+  struct timespec next;	/* deadline of the next tick */
+  ShutdownToken *token;	/* cuts the wait short */
+};
+
+/* Starts the clock, its first tick is due one tick from now. Its waits end
+   early once `token' is cancelled */
+void tickClockStart(TickClock *clock, ShutdownToken *token);
+
+/* Sleeps until the next tick is due and returns how many ticks came due,
+   more than one when the caller fell behind and has steps to catch up on.
+   When it falls too far behind the extra ticks are dropped instead. Returns
+   0 at once if the clock's token is cancelled */
+int tickClockWait(TickClock *clock);
+
+/* Makes every tick `speedup' times shorter, e.g. to replay faster than real
+   time. Ticks don't get shorter than 1 usec, faster speedups are cut to that */
+void setTickSpeedup(int speedup);
 
 /* clears the input buffer and then waits for one more key */
 void finalKeypress();
@@ -71,4 +184,8 @@ void finalKeypress();
 /* gets a timespec that represents the time of one tick */
 struct timespec getTimeout(int ticks);
 
+/* Game time of `ticks' ticks in seconds, at normal speed whatever the
+   speedup. The clock recordings are stamped with */
+double tickSeconds(unsigned long ticks);
+
 #endif /* CONSOLE_H */
@@ -0,0 +1,41 @@
+/**********************************************************************
+  Module: consolebackend.h
+
+  Purpose: Output backends behind console.c. console.c owns the
+	   framebuffer and compositor; a backend only gets told which rows
+	   changed when a frame is published.
+
+  NOTES: the compositor calls drawRow/present with its publish lock
+	 held, so a backend never sees two frames at once. Backends that
+	 can run in many sessions keep their state in the current
+	 session's backendState.
+**********************************************************************/
+
+#ifndef CONSOLEBACKEND_H
+#define CONSOLEBACKEND_H
+
+#include <stdbool.h>
+
+typedef struct CONSOLE_BACKEND ConsoleBackend;
+struct CONSOLE_BACKEND {
+	/* Sets up the output device for a `height'x`width' console */
+	bool (*init)(int height, int width);
+	/* Copies one changed framebuffer row of `width' cells */
+	void (*drawRow)(int row, const char *cells, int width);
+	/* Shows everything drawn since the last present */
+	void (*present)(void);
+	/* Throws away pending input and waits for one more key */
+	void (*waitForKey)(void);
+	/* Shuts the output device down */
+	void (*finish)(void);
+};
+
+extern ConsoleBackend cursesBackend;
+extern ConsoleBackend headlessBackend;
+extern ConsoleBackend ptyBackend;
+
+/* Frames published by the headless backend are appended to this file
+   (NULL turns dumping off). Call before consoleInit. */
+extern void headlessDumpFrames(const char *path);
+
+#endif /* CONSOLEBACKEND_H */
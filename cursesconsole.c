@@ -0,0 +1,65 @@
+/**********************************************************************
+  Module: cursesconsole.c
+
+  Purpose: curses backend for console.c. see consolebackend.h
+
+  NOTES: this is the only file that talks to curses.
+**********************************************************************/
+
+#include "consolebackend.h"
+#include <curses.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+static bool checkConsoleSize(int reqHeight, int reqWidth) 
+{
+
+	if ( (reqWidth > COLS) || (reqHeight > LINES) ) 
+ 	{
+    		fprintf(stderr, "\n\n\rSorry, your window is only %ix%i. \n\r%ix%i is required. Sorry.\n\r", COLS, LINES, reqWidth, reqHeight);
+    		return (false);
+  	}
+
+  return(true);
+}
+
+static bool cursesInit(int height, int width)
+{
+	initscr();
+	crmode();
+	noecho();
+	clear();
+
+	return checkConsoleSize(height, width);
+}
+
+static void cursesDrawRow(int row, const char *cells, int width)
+{
+	mvaddnstr(row, 0, cells, width);
+}
+
+static void cursesPresent(void)
+{
+	move(LINES-1, COLS-1);
+	refresh();
+}
+
+static void cursesWaitForKey(void)
+{
+	flushinp();
+    	move(LINES-1, COLS-1);
+	getch(); /* wait for user to press a character, blocking. */
+}
+
+static void cursesFinish(void)
+{
+	endwin();
+}
+
+ConsoleBackend cursesBackend = {
+	cursesInit,
+	cursesDrawRow,
+	cursesPresent,
+	cursesWaitForKey,
+	cursesFinish
+};
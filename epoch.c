@@ -0,0 +1,169 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file does epoch based reclamation. A log that goes off screen is unlinked from its lane right away, but a
+ * thread may still be holding it from a snapshot it took earlier, so it can't go back to the pool yet. Retired items
+ * wait in the limbo bucket of the epoch they were retired in. The global epoch only moves forward once every reader
+ * has caught up to it, so by the time it has moved twice nobody can be holding anything from the oldest bucket and
+ * it is reclaimed. Readers only publish which epoch they are in, so reading never takes a lock. Every session has its
+ * own domain, and a reader borrows a slot in it for as long as it reads, so a server worker can read in many sessions.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "epoch.h"
+#include "gameglobals.h"
+#include "threadwrappers.h"
+#include "session.h"
+
+#define NUM_BUCKETS 3 //current epoch, the one before, and the one being reclaimed
+#define QUIESCENT 0   //reader slot value for a slot nobody is reading in
+
+typedef struct LIMBO Limbo;
+struct LIMBO {
+   void **items;
+   int count;
+};
+
+/* One session's reclamation domain */
+typedef struct EPOCH_STATE EpochState;
+struct EPOCH_STATE {
+   atomic_ulong globalEpoch;
+   atomic_ulong readerEpoch[MAX_EPOCH_THREADS];
+   Limbo limbo[NUM_BUCKETS];
+   int limboCapacity;
+   void (*reclaimItem)(void *item);
+   pthread_mutex_t limboLock;
+};
+
+//---PROTOTYPES---------------------------------------------------------
+static void tryAdvance(EpochState *epochs);
+static void reclaimBucket(EpochState *epochs, Limbo *bucket);
+static EpochState *state();
+//---METHODS------------------------------------------------------------//
+
+bool initEpochs(int capacity, void (*reclaim)(void *item)){
+   EpochState *epochs = (EpochState *)calloc(1, sizeof(EpochState));
+   bool success = epochs != NULL;
+   char name[32];
+   int i;
+   if(!success){
+      return false;
+   }
+   atomic_store(&epochs->globalEpoch, 1);
+   pthread_mutex_init(&epochs->limboLock, NULL);
+   snprintf(name, sizeof(name), "s%d.limboLock", currentSession()->id);
+   nameLock(&epochs->limboLock, name);
+   epochs->reclaimItem = reclaim;
+   epochs->limboCapacity = capacity;
+   for(i = 0; i < NUM_BUCKETS; i++){
+      epochs->limbo[i].items = (void **)malloc(capacity*sizeof(void *));
+      success = success && epochs->limbo[i].items != NULL;
+   }
+   currentSession()->epochs = epochs;
+   return success;
+}
+
+int epochEnter(){
+   EpochState *epochs = state();
+   unsigned long epoch, idle;
+   int slot = -1;
+   int i;
+
+   //claim a free slot by publishing the epoch in it
+   epoch = atomic_load(&epochs->globalEpoch);
+   for(i = 0; i < MAX_EPOCH_THREADS && slot < 0; i++){
+      idle = QUIESCENT;
+      if(atomic_compare_exchange_strong(&epochs->readerEpoch[i], &idle, epoch)){
+         slot = i;
+      }
+   }
+   if(slot < 0){
+      printError(); //more readers at once than slots
+   }
+   //re-check, so the epoch can't move past us unseen
+   while((epoch = atomic_load(&epochs->globalEpoch)) != atomic_load(&epochs->readerEpoch[slot])){
+      atomic_store(&epochs->readerEpoch[slot], epoch);
+   }
+   return slot;
+}
+
+void epochExit(int slot){
+   atomic_store(&state()->readerEpoch[slot], QUIESCENT);
+}
+
+void epochRetire(void *item){
+   EpochState *epochs = state();
+   Limbo *bucket;
+   lockMutex(&epochs->limboLock);
+   bucket = &epochs->limbo[atomic_load(&epochs->globalEpoch) % NUM_BUCKETS];
+   if(bucket->count == epochs->limboCapacity){ //every item is already waiting here, can't happen with a pool sized right
+      unlockMutex(&epochs->limboLock);
+      printError();
+   }
+   bucket->items[bucket->count++] = item;
+   tryAdvance(epochs);
+   unlockMutex(&epochs->limboLock);
+}
+
+int epochPending(){
+   EpochState *epochs = state();
+   int pending = 0;
+   int i;
+   lockMutex(&epochs->limboLock);
+   for(i = 0; i < NUM_BUCKETS; i++){
+      pending += epochs->limbo[i].count;
+   }
+   unlockMutex(&epochs->limboLock);
+   return pending;
+}
+
+void destroyEpochs(){
+   EpochState *epochs = state();
+   int i;
+   if(epochs == NULL){
+      return;
+   }
+   for(i = 0; i < NUM_BUCKETS; i++){
+      if(epochs->limbo[i].items != NULL){
+         reclaimBucket(epochs, &epochs->limbo[i]);
+      }
+      free(epochs->limbo[i].items);
+   }
+   destroyMutex(&epochs->limboLock);
+   free(epochs);
+   currentSession()->epochs = NULL;
+}
+
+/* Moves the epoch on if every reader is either idle or already in it, then
+   reclaims the bucket two epochs back. Caller holds limboLock */
+static void tryAdvance(EpochState *epochs){
+   unsigned long epoch = atomic_load(&epochs->globalEpoch);
+   unsigned long seen;
+   int i;
+   for(i = 0; i < MAX_EPOCH_THREADS; i++){
+      seen = atomic_load(&epochs->readerEpoch[i]);
+      if(seen != QUIESCENT && seen != epoch){
+         return; //somebody is still reading from an older epoch
+      }
+   }
+   atomic_store(&epochs->globalEpoch, epoch+1);
+   reclaimBucket(epochs, &epochs->limbo[(epoch+1) % NUM_BUCKETS]);
+}
+
+static void reclaimBucket(EpochState *epochs, Limbo *bucket){
+   int i;
+   for(i = 0; i < bucket->count; i++){
+      epochs->reclaimItem(bucket->items[i]);
+   }
+   bucket->count = 0;
+}
+
+static EpochState *state(){
+   return currentSession()->epochs;
+}
@@ -0,0 +1,32 @@
+/* The header file for epoch.c
+*/
+
+#ifndef EPOCH_H
+#define EPOCH_H
+#include <stdbool.h>
+
+#define MAX_EPOCH_THREADS 16 //readers in one session at once
+
+/* Sets up reclamation in the current session for up to `capacity' retired
+   items at a time. Retired items are handed to `reclaim' once no reader can
+   still be looking at them */
+bool initEpochs(int capacity, void (*reclaim)(void *item));
+
+/* Marks the calling thread as reading shared items. Anything it can reach
+   stays allocated until epochExit is called with the slot this returns */
+int epochEnter();
+
+/* Marks the calling thread as done reading */
+void epochExit(int slot);
+
+/* Hands an item that is no longer reachable to the reclaimer. It is freed
+   after every reader that might have seen it has left */
+void epochRetire(void *item);
+
+/* Number of retired items still waiting to be reclaimed */
+int epochPending();
+
+/* Reclaims everything still waiting. Only call once no thread is reading */
+void destroyEpochs();
+
+#endif
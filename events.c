@@ -0,0 +1,157 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file is a small event bus. Publishers hand an event to the bus and every subscriber that asked for that type gets
+ * its own copy in its own queue, so a slow subscriber never misses an event another one already took. Subscribers sleep
+ * on a condition variable until something arrives, so waiting for an event costs nothing.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "events.h"
+#include "gameglobals.h"
+#include "threadwrappers.h"
+#include "session.h"
+
+#define MAX_SUBSCRIBERS 16
+
+/* The event bus of one session */
+typedef struct EVENT_STATE EventState;
+struct EVENT_STATE {
+   Subscriber *subscribers[MAX_SUBSCRIBERS];
+   int numSubscribers;
+   unsigned long published[NUM_EVENT_TYPES];
+   pthread_mutex_t busLock;
+};
+
+//---PROTOTYPES---------------------------------------------------------
+static EventState *state();
+//---METHODS------------------------------------------------------------//
+
+void initEvents(){
+   EventState *bus = state();
+   char name[32];
+   if(bus == NULL){
+      bus = (EventState *)calloc(1, sizeof(EventState));
+      if(bus == NULL){
+         printError();
+      }
+      pthread_mutex_init(&bus->busLock, NULL);
+      snprintf(name, sizeof(name), "s%d.busLock", currentSession()->id);
+      nameLock(&bus->busLock, name);
+      currentSession()->events = bus;
+   }
+   memset(bus->published, 0, sizeof(bus->published));
+}
+
+Subscriber *subscribe(int mask){
+   EventState *bus = state();
+   Subscriber *sub = (Subscriber *)calloc(1, sizeof(Subscriber));
+   if(sub == NULL){
+      printError();
+   }
+   sub->mask = mask;
+   pthread_cond_init(&sub->ready, NULL);
+
+   lockMutex(&bus->busLock);
+   if(bus->numSubscribers == MAX_SUBSCRIBERS){
+      printError();
+   }
+   bus->subscribers[bus->numSubscribers++] = sub;
+   unlockMutex(&bus->busLock);
+   return sub;
+}
+
+void publishEvent(enum eventType type, int value){
+   EventState *bus = state();
+   Subscriber *sub;
+   GameEvent *event;
+   int i;
+
+   lockMutex(&bus->busLock);
+   bus->published[type]++;
+   for(i = 0; i < bus->numSubscribers; i++){
+      sub = bus->subscribers[i];
+      if((sub->mask & EVENT_BIT(type)) == 0){
+         continue;
+      }
+      if(sub->count == EVENT_QUEUE_SIZE){ //full, the oldest event makes room
+         sub->front = (sub->front + 1) % EVENT_QUEUE_SIZE;
+         sub->count--;
+         sub->dropped++;
+      }
+      event = &sub->queue[(sub->front + sub->count) % EVENT_QUEUE_SIZE];
+      event->type = type;
+      event->tick = getTick();
+      event->value = value;
+      sub->count++;
+      pthread_cond_signal(&sub->ready);
+   }
+   unlockMutex(&bus->busLock);
+}
+
+void waitEvent(Subscriber *sub, GameEvent *event){
+   EventState *bus = state();
+   lockMutex(&bus->busLock);
+   while(sub->count == 0){
+      pthread_cond_wait(&sub->ready, &bus->busLock);
+   }
+   *event = sub->queue[sub->front];
+   sub->front = (sub->front + 1) % EVENT_QUEUE_SIZE;
+   sub->count--;
+   unlockMutex(&bus->busLock);
+}
+
+bool pollEvent(Subscriber *sub, GameEvent *event){
+   EventState *bus = state();
+   bool taken = false;
+   lockMutex(&bus->busLock);
+   if(sub->count > 0){
+      *event = sub->queue[sub->front];
+      sub->front = (sub->front + 1) % EVENT_QUEUE_SIZE;
+      sub->count--;
+      taken = true;
+   }
+   unlockMutex(&bus->busLock);
+   return taken;
+}
+
+unsigned long eventCount(enum eventType type){
+   EventState *bus = state();
+   unsigned long count;
+   lockMutex(&bus->busLock);
+   count = bus->published[type];
+   unlockMutex(&bus->busLock);
+   return count;
+}
+
+void destroyEvents(){
+   EventState *bus = state();
+   int i;
+   lockMutex(&bus->busLock);
+   for(i = 0; i < bus->numSubscribers; i++){
+      pthread_cond_destroy(&bus->subscribers[i]->ready);
+      free(bus->subscribers[i]);
+   }
+   bus->numSubscribers = 0;
+   unlockMutex(&bus->busLock);
+}
+
+void freeEvents(){
+   EventState *bus = state();
+   if(bus != NULL){
+      destroyEvents();
+      destroyMutex(&bus->busLock);
+      free(bus);
+      currentSession()->events = NULL;
+   }
+}
+
+static EventState *state(){
+   return currentSession()->events;
+}
@@ -0,0 +1,57 @@
+/* The header file for events.c
+*/
+
+#ifndef EVENTS_H
+#define EVENTS_H
+#include <stdbool.h>
+#include <pthread.h>
+
+enum eventType {frogDied, podReached, gameOver, logRetired, NUM_EVENT_TYPES};
+#define EVENT_BIT(type) (1 << (type))
+
+#define EVENT_QUEUE_SIZE 32
+
+typedef struct GAME_EVENT GameEvent;
+struct GAME_EVENT {
+   enum eventType type;
+   unsigned long tick;
+   int value; //pod number for podReached, lane row for logRetired
+};
+
+typedef struct SUBSCRIBER Subscriber;
+struct SUBSCRIBER {
+   int mask; //EVENT_BIT of every type this subscriber wants
+   GameEvent queue[EVENT_QUEUE_SIZE];
+   int front;
+   int count;
+   unsigned long dropped;
+   pthread_cond_t ready;
+};
+
+/* Sets up the current session's event bus and zeroes its counts. Call before
+   anything subscribes or publishes */
+void initEvents();
+
+/* Registers a subscriber for the event types in `mask'. Events published
+   before this call are not delivered to it */
+Subscriber *subscribe(int mask);
+
+/* Queues the event for every subscriber that wants it and wakes them */
+void publishEvent(enum eventType type, int value);
+
+/* Blocks until the subscriber has an event, then takes it */
+void waitEvent(Subscriber *sub, GameEvent *event);
+
+/* Takes the subscriber's next event if there is one, without blocking */
+bool pollEvent(Subscriber *sub, GameEvent *event);
+
+/* Number of events of the type published so far */
+unsigned long eventCount(enum eventType type);
+
+/* Frees every subscriber. The counts stay readable until the session is freed */
+void destroyEvents();
+
+/* Frees the current session's event bus, counts and all */
+void freeEvents();
+
+#endif
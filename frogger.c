@@ -3,11 +3,13 @@
  * REBECCA TIESSEN
  *
  * This file takes care of the main game logic, and setting up initializer 
- * methods. It also keeps track of player lives
+ * methods. It also keeps track of player lives. Everything works on the current
+ * session, so the local game and every server session run the same code
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
@@ -18,86 +20,189 @@
 #include "player.h"
 #include "gameglobals.h"
 #include "log.h"
-#include "llist.h"
+#include "lanes.h"
+#include "replay.h"
+#include "input.h"
+#include "events.h"
+#include "session.h"
+#include "snapshot.h"
+#include "timerwheel.h"
+#include "trace.h"
 
+static unsigned long runTicks = 0; //0 runs until the player quits or the game ends
+static unsigned int gameSeed;
+static const char *savePath = NULL; //snapshot written when the game stops
+//---PROTOTYPES------------------------------------------------------//
+static int nextKey(unsigned long tick, long tickStart);
+static void finishTick(unsigned long tick);
 //-------------------------------------------------------------------//
-int main(int argc, char**argv) {
-  startGame();
-  printf("done!\n");
-}
+void startGame(unsigned int seed, unsigned long ticks){
+   gameSeed = seed;
+   runTicks = ticks;
+   Subscriber *endWatch;
+   GameEvent event;
+   bool running;
+   bool saved = true;
 
-void startGame(){
-   //initialize all mutexes and condLock
+   //initialize all mutexes and the event bus
    initLocks();
-   if(drawScreen()){
-      createThread(&tids[getThreadCount()], updateLives, NULL);
-      createThread(&tids[getThreadCount()], refreshScreen, NULL);
-      initializePlayer();
-      initializeLogs();
-
-      lockMutex(&mainLock);
-      while(!isGameOver()){
-         pthread_cond_wait(&condLock, &mainLock);
-      }
-      unlockMutex(&mainLock);
+   initEvents();
+   endWatch = subscribe(EVENT_BIT(gameOver));
+   running = openGame(gameSeed) && (!snapshotLoaded() || restoreSnapshot());
+   if(running){
+      startThread(refreshScreen, NULL);
+      initializeInput();
+      startThread(runGame, subscribe(EVENT_BIT(frogDied)));
+
+      waitEvent(endWatch, &event);
    }
    finalKeypress();
-   int i;
-   for(i = 0; i < getThreadCount(); i++){
-      joinThread(tids[i]);
+   joinThreads();
+   //the board is still there until closeGame. A finished game has nothing left to resume
+   if(running && savePath != NULL && currentSession()->lives > 0 && !podsFilled()){
+      saved = saveSnapshot(savePath);
    }
+   destroyEvents();
+   deleteInput();
+   closeGame();
    destroyLocks();
-   free(getFrog());
-   deleteList();
+   if(!saved){ //the console is closed, so this doesn't land on the board
+      fprintf(stderr, "Can't save a snapshot to %s\n", savePath);
+   }
+}
+
+void saveOnExit(const char *path){
+   savePath = path;
+}
+
+bool openGame(unsigned int seed){
+   Session *session = currentSession();
+   session->gameOver = false;
+   shutdownReset(&session->shutdown);
+   session->tick = 0;
+   session->lives = MAX_LIVES;
+   if(!drawScreen() || !initTimers()){
+      return false;
+   }
+   initializePlayer();
+   initializeLogs(seed);
+   return true;
+}
+
+void closeGame(){
+   deletePlayer();
+   deleteTimers();
+   deleteLogs();
    consoleFinish();
 }
 
 void *refreshScreen(){
+   TickClock clock;
+   tickClockStart(&clock, &currentSession()->shutdown);
    while(!isGameOver()){
-      lockMutex(&screenLock);
-      consoleRefresh();
-      unlockMutex(&screenLock);
-      sleepTicks(1); 
+      consoleRefresh(); //only publishes when something was drawn
+      tickClockWait(&clock); //a late frame is just skipped
    }
    pthread_exit(NULL);
 }
 
-void *updateLives(){
-   Frog *frog = getFrog();
-   int lifeCount = MAX_LIVES;
-   char strLives[2];
+void *runGame(void *lives){
+   Subscriber *deaths = (Subscriber *)lives;
+   GameEvent event;
+   TickClock clock;
+   int due;
+   tickClockStart(&clock, &currentSession()->shutdown);
+   while(!isGameOver()){
+      due = tickClockWait(&clock);
+      while(due-- > 0 && !isGameOver()){ //catches up on ticks missed under load
+         stepGame();
+         while(pollEvent(deaths, &event)){ //on this thread so a life is lost on the same tick every run
+            loseLife();
+         }
+      }
+   }
+   pthread_exit(NULL);
+}
 
-   while(frog == NULL){
-      frog = getFrog(); //deals with initialization of thread before frog is created
+void stepGame(){
+   unsigned long tick = advanceTick();
+   long tickStart = inputClock();
+   int key;
+   traceBegin("stepGame");
+   runTimers(tick);
+   while(!isGameOver() && (key = nextKey(tick, tickStart)) != NO_KEY){
+      applyKey(key);
    }
-   while(!isGameOver()){
-      if(frog->dead){
-         lifeCount--;
-         sprintf(strLives, "%d", lifeCount);
-         lockMutex(&screenLock);
-         putString(strLives, 0, 42, 1);
-         unlockMutex(&screenLock);
-
-	 lockMutex(&playerLock);
-	 frog->dead = false;
-	 unlockMutex(&playerLock);
+   finishTick(tick);
+   traceEnd();
+}
+
+void stepGameWithKey(int key){
+   unsigned long tick = advanceTick();
+   traceBegin("stepGame");
+   runTimers(tick);
+   if(key != NO_KEY && !isGameOver()){
+      applyKey(key);
+   }
+   finishTick(tick);
+   traceEnd();
+}
+
+/* Everything in a tick after its keys */
+static void finishTick(unsigned long tick){
+   animateFrog();
+   stepLanes();
+   followFrog();
+   if(tick % CHECKSUM_TICKS == 0 && isJournaling()){ //nothing to check it against otherwise
+      checkBoard(tick, consoleChecksum());
+   }
+
+   if(runTicks > 0 && tick >= runTicks){
+      endGame("time's up");
+   }
+   else if(replayFinished(tick)){
+      endGame("replay finished");
+   }
+}
+
+/* Keys come from the journal when replaying (only a live quit gets through),
+   otherwise from the input thread, and get journaled if recording. Only keys
+   read before the tick started belong to it, later ones wait for the next */
+static int nextKey(unsigned long tick, long tickStart){
+   InputAction action;
+   int key = NO_KEY;
+   if(isReplaying()){
+      key = replayKey(tick);
+      if(key == NO_KEY && takeAction(&action, tickStart) && action.key == QUIT){
+         key = QUIT;
       }
-      sleepTicks(1);
-      if(lifeCount <= 0){
-	 endGame("GAME OVER");
+   }
+   else if(takeAction(&action, tickStart)){
+      key = action.key;
+      recordKey(tick, key);
+   }
+   return key;
+}
+
+void loseLife(){
+   Session *session = currentSession();
+   char strLives[12];
+   if(session->lives > 0){
+      session->lives--;
+      snprintf(strLives, sizeof(strLives), "%d", session->lives);
+      putString(strLives, 0, livesCol(), 1);
+      if(session->lives == 0){
+         endGame("GAME OVER");
       }
    }
-   pthread_exit(NULL);
 }
 
 void endGame(char *endMsg){
-   lockMutex(&screenLock);
    putBanner(endMsg);
    disableConsole(1);
-   unlockMutex(&screenLock);
 
-   lockMutex(&mainLock);
    setGameOver();
-   pthread_cond_signal(&condLock);
-   unlockMutex(&mainLock);
+   publishEvent(gameOver, 0);
+   stopInput();
+   shutdownCancel(&currentSession()->shutdown); //every thread of the game wakes up now instead of at the end of its wait
 }
@@ -4,20 +4,50 @@
 #ifndef FROGGER_H
 #define FROGGER_H
 
+#include <stdbool.h>
+
 #define MAX_LIVES 4
 
 /* Initializes player and logs, as well as the refresh screen and update lives
-   methods. Sets a condition variable to wait for gameover */
-void startGame();
+   methods. Waits for the game over event. Spawns are seeded
+   from `seed', and a non-zero `ticks' ends the game on that tick. A loaded
+   snapshot is restored into the game before it starts */
+void startGame(unsigned int seed, unsigned long ticks);
+
+/* Makes startGame save a snapshot of the game to `path' when it stops */
+void saveOnExit(const char *path);
+
+/* Resets the current session and sets up its board, frog and lanes, with
+   spawns seeded from `seed'. Returns false if the console can't be set up */
+bool openGame(unsigned int seed);
+
+/* Frees the current session's frog, lanes and console */
+void closeGame();
+
+/* The game loop thread of the local game, one stepGame per tick on a fixed
+   timestep, catching up when it falls behind. The frog's deaths on the `lives'
+   subscription are taken off a life after each tick */
+void *runGame(void *lives);
+
+/* One tick of the current session. Runs the timers due on it, applies the keys
+   for that tick, animates the frog, steps the lanes and checksums the board for
+   the journal */
+void stepGame();
+
+/* One tick of the current session with `key' as its only key (NO_KEY for none)
+   instead of the input queue or the journal, for callers that pick the moves */
+void stepGameWithKey(int key);
 
 /* Calls the console refresh method */
 void *refreshScreen();
 
-/* Checks if the frog is dead and updates the player lives */
-void *updateLives();
+/* Takes one of the current session's lives away and ends the game when
+   they run out */
+void loseLife();
 
-/* Displays an end of game message and signals the condition variable, and sets
-   game over to true. */
+/* Displays an end of game message, sets game over to true, publishes the
+   game over event and cancels the session's shutdown token so no thread of
+   the game sleeps on past it. */
 void endGame(char *endMessage);
 
 #endif
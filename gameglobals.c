@@ -3,91 +3,183 @@
  * REBECCA TIESSEN
  * 
  * This file includes methods used by all files in order to check for game over, thread count, and setting up locks.
+ * It also holds the board size and lane layout, which are picked at startup, and builds the board from them. All of it
+ * belongs to the current session.
  *
  */
 
+#include <stdio.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include "gameglobals.h"
 #include "console.h"
+#include "threadwrappers.h"
+#include "session.h"
 
-static bool gameOver = false;
-static int threadCount = 0;
-char *GAME_BOARD[] = {
-"                                   Lives: 4",
-"/------\\          /------\\          /------\\          /------\\          /------\\",
-"|      |          |      |          |      |          |      |          |      |",
-"+      +----------+      +----------+      +----------+      +----------+      +",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"",
-"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"",
-"",
-"",
-"" };
+#define LIVES_LABEL "Lives: 4"
+#define POD_TOP    "/------\\"
+#define POD_MIDDLE "|      |"
+#define POD_BOTTOM "+      +"
+#define BANK_EDGE '"'
 
+//---PROTOTYPES---------------------------------------------------------
+static int livesLabelCol();
+static void drawPods(char **board);
+//---METHODS------------------------------------------------------------//
+
+bool setBoardSize(int cols, int lanes){
+   bool valid = cols >= MIN_COLS && cols <= MAX_COLS && lanes >= 1 && lanes <= MAX_LANES;
+   if(valid){
+      currentSession()->numCols = cols;
+      currentSession()->numLanes = lanes;
+   }
+   return valid;
+}
+
+int boardRows(){
+   return SAFE_BANK + boardLanes()*LANE_HEIGHT + BANK_ROWS;
+}
+
+int boardCols(){
+   return currentSession()->numCols;
+}
+
+int boardLanes(){
+   return currentSession()->numLanes;
+}
+
+int laneRow(int lane){
+   return SAFE_BANK + lane*LANE_HEIGHT;
+}
+
+int startBank(){
+   return laneRow(boardLanes());
+}
+
+/* Pods are spread evenly from the left edge to the right one, 18 columns apart
+   on the original 80 column board */
+int podCol(int pod){
+   return pod * (boardCols() - POD_WIDTH - 1) / (NUM_PODS - 1);
+}
+
+int livesCol(){
+   return livesLabelCol() + strlen(LIVES_LABEL) - 1;
+}
+
+/* The board is built for its size instead of being one fixed picture: the lives
+   counter, the pods joined by a fence, open water for every lane, and the start
+   bank. The console keeps its own copy so this one is freed once it's drawn */
 bool drawScreen(){
-   return consoleInit(GAME_ROWS, GAME_COLS, GAME_BOARD);
+   int rows = boardRows();
+   int numCols = boardCols();
+   char **board = (char **)malloc(rows*sizeof(char *));
+   bool success = board != NULL;
+   int i;
+
+   for(i = 0; i < rows && success; i++){
+      board[i] = (char *)malloc(numCols+1);
+      success = board[i] != NULL;
+      if(success){
+         memset(board[i], ' ', numCols);
+         board[i][numCols] = '\0';
+      }
+   }
+   if(success){
+      memcpy(board[0] + livesLabelCol(), LIVES_LABEL, strlen(LIVES_LABEL));
+      drawPods(board);
+      memset(board[startBank()], BANK_EDGE, numCols);
+      success = consoleInitView(rows, numCols, rows < VIEW_ROWS ? rows : VIEW_ROWS,
+                                numCols < VIEW_COLS ? numCols : VIEW_COLS, board);
+   }
+   for(; i > 0; i--){
+      free(board[i-1]);
+   }
+   free(board);
+   return success;
+}
+
+static int livesLabelCol(){
+   return boardCols()/2 - 5;
+}
+
+static void drawPods(char **board){
+   int width = strlen(POD_TOP);
+   int col;
+   int i;
+   for(i = 0; i < NUM_PODS; i++){
+      col = podCol(i);
+      memcpy(board[1] + col, POD_TOP, width);
+      memcpy(board[2] + col, POD_MIDDLE, width);
+      memcpy(board[3] + col, POD_BOTTOM, width);
+      if(i+1 < NUM_PODS){ //fence up to the next pod
+         memset(board[3] + col + width, '-', podCol(i+1) - col - width);
+      }
+   }
 }
 
 void initLocks(){
+   Session *session = currentSession();
+   char name[32];
+
    // Mutex locks
-   pthread_mutex_init(&screenLock, NULL);
-   pthread_mutex_init(&playerLock, NULL);
-   pthread_mutex_init(&mainLock, NULL);
-   pthread_mutex_init(&threadCountLock, NULL);
-   pthread_mutex_init(&listLock, NULL);
-   // Conditional variable lock
-   pthread_cond_init(&condLock, NULL);
+   pthread_mutex_init(&session->playerLock, NULL);
+   pthread_mutex_init(&session->threadCountLock, NULL);
+
+   snprintf(name, sizeof(name), "s%d.playerLock", session->id);
+   nameLock(&session->playerLock, name);
+   snprintf(name, sizeof(name), "s%d.threadCountLock", session->id);
+   nameLock(&session->threadCountLock, name);
 }
 
 void destroyLocks(){
-   pthread_mutex_destroy(&screenLock);
-   pthread_mutex_destroy(&playerLock);
-   pthread_mutex_destroy(&mainLock);
-   pthread_mutex_destroy(&threadCountLock);
-   pthread_mutex_destroy(&listLock);
+   destroyMutex(&currentSession()->playerLock);
+   destroyMutex(&currentSession()->threadCountLock);
+
+}
 
-   pthread_cond_destroy(&condLock);
+pthread_mutex_t *playerLock(){
+   return &currentSession()->playerLock;
+}
+
+void startThread(void *(*func)(void *), void *param){
+   Session *session = currentSession();
+   lockMutex(&session->threadCountLock);
+   if(session->threadCount == NUM_THREADS){
+      printError();
+   }
+   createThread(&session->tids[session->threadCount], func, param);
+   session->threadCount++;
+   unlockMutex(&session->threadCountLock);
+}
 
+void joinThreads(){
+   Session *session = currentSession();
+   int i;
+   for(i = 0; i < session->threadCount; i++){
+      joinThread(session->tids[i]);
+   }
+   session->threadCount = 0;
 }
 
 void setGameOver(){
-   gameOver = true;
+   currentSession()->gameOver = true;
 }
 
 bool isGameOver(){
-   return gameOver;
+   return currentSession()->gameOver;
 }
 
-int getThreadCount(){
-   return threadCount;
+unsigned long getTick(){
+   return currentSession()->tick;
 }
 
-void incrementThreadCount(i){
-   threadCount++;
+unsigned long advanceTick(){
+   return ++currentSession()->tick;
 }
 
-void decrementThreadCount(){
-   threadCount--;
+int getThreadCount(){
+   return currentSession()->threadCount;
 }
 
-void sleepLoop(int numTicks){
-   int i;
-   for(i = 0; i < numTicks && !isGameOver(); i++){
-      sleepTicks(i);
-   }
-}
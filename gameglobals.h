@@ -5,17 +5,23 @@
 #define GAMEGLOBALS_H
 
 #include <stdbool.h> 
+#include <pthread.h>
 
 //---GLOBALS-------------------------------------//
-#define GAME_ROWS 24
-#define GAME_COLS 80
+#define VIEW_ROWS 24  //most of the board shown at once, the view scrolls over the rest
+#define VIEW_COLS 80
+#define DEFAULT_COLS 80
+#define DEFAULT_LANES 4
+#define MIN_COLS 40   //room for every pod
+#define MAX_COLS 4096
+#define MAX_LANES 256
+#define LANE_HEIGHT 4
+#define BANK_ROWS 4   //start bank and the rows the frog starts on, under the last lane
 #define NUM_THREADS 64
 #define LEFT_EDGE 0
-#define RIGHT_EDGE 80
 #define NUM_PODS 5
 #define POD_WIDTH 7
-#define START_BANK 20
-#define SAFE_BANK 4
+#define SAFE_BANK 4   //first row of the first lane, everything above is the home bank
 #define LEFT_KEY 'a'
 #define RIGHT_KEY 'd'
 #define UP_KEY 'w'
@@ -24,35 +30,63 @@
 
 enum state {first, second};
 
-pthread_cond_t condLock;
-pthread_mutex_t refreshLock, screenLock, playerLock, threadCountLock, listLock, mainLock;
-pthread_t tids[NUM_THREADS];
+/* Sets the board width and number of lanes. Call before drawScreen. Returns
+   false if either is out of range */
+bool setBoardSize(int cols, int lanes);
 
-/* Draws the initial game screen */
+/* Returns the number of rows on the board */
+int boardRows();
+
+/* Returns the number of columns on the board */
+int boardCols();
+
+/* Returns the number of lanes on the board */
+int boardLanes();
+
+/* Returns the top row of the given lane */
+int laneRow(int lane);
+
+/* Returns the row of the start bank under the last lane */
+int startBank();
+
+/* Returns the left column of the given pod */
+int podCol(int pod);
+
+/* Returns the column the lives counter is drawn at */
+int livesCol();
+
+/* Builds the board for the current size and draws the initial game screen */
 bool drawScreen();
 
-/* Initializes all mutexes and cond variable */
+/* Initializes the current session's mutexes */
 void initLocks();
 
-/* Destroys the mutexes and cond variable */
+/* Destroys the current session's mutexes */
 void destroyLocks();
 
+/* Returns the lock guarding the current session's frog */
+pthread_mutex_t *playerLock();
+
+/* Starts a thread for the current session. It works on the same session and
+   is joined by joinThreads */
+void startThread(void *(*func)(void *), void *param);
+
+/* Joins every thread the current session started */
+void joinThreads();
+
 /* Sets game over to true */
 void setGameOver();
 
 /* Checks if game over is true */
 bool isGameOver();
 
-/* Returns the current thread count */
-int getThreadCount();
+/* Returns the current game tick */
+unsigned long getTick();
 
-/* Increments the number of threads */
-void incrementThreadCount();
+/* Starts the next game tick, only called by the game loop */
+unsigned long advanceTick();
 
-/*Decrements the number of threads */
-void decrementThreadCount();
-
-/* Sleeps */
-void sleepLoop(int ticks);
+/* Returns the current thread count */
+int getThreadCount();
 
 #endif
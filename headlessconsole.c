@@ -0,0 +1,109 @@
+/**********************************************************************
+  Module: headlessconsole.c
+
+  Purpose: in-memory backend for console.c, for benchmarks and soak
+	   runs with no terminal attached. see consolebackend.h
+
+  NOTES: keeps its own copy of the screen, the same way a terminal
+	 would, and optionally appends every published frame to a file.
+	 The copy belongs to the current session, so many headless
+	 sessions can run at once.
+**********************************************************************/
+
+#include "consolebackend.h"
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+typedef struct HEADLESS_SCREEN HeadlessScreen;
+struct HEADLESS_SCREEN {
+	char *screen;
+	int SCR_HEIGHT, SCR_WIDTH;
+	FILE *dumpFile;
+	long frameNumber;
+};
+
+static const char *dumpPath = NULL;
+
+void headlessDumpFrames(const char *path)
+{
+	dumpPath = path;
+}
+
+static HeadlessScreen *screenState(void)
+{
+	return currentSession()->backendState;
+}
+
+static bool headlessInit(int height, int width)
+{
+	HeadlessScreen *h = calloc(1, sizeof(HeadlessScreen));
+
+	if (h == NULL)
+		return (false);
+	currentSession()->backendState = h;
+	h->SCR_HEIGHT = height;  h->SCR_WIDTH = width;
+	h->screen = malloc((size_t)height * width);
+	if (h->screen == NULL)
+		return (false);
+	memset(h->screen, ' ', (size_t)height * width);
+
+	if (dumpPath != NULL && (h->dumpFile = fopen(dumpPath, "w")) == NULL)
+	{
+		fprintf(stderr, "Can't open frame dump %s\n", dumpPath);
+		return (false);
+	}
+	return (true);
+}
+
+static void headlessDrawRow(int row, const char *cells, int width)
+{
+	HeadlessScreen *h = screenState();
+
+	memcpy(h->screen + (size_t)row*h->SCR_WIDTH, cells, width);
+}
+
+static void headlessPresent(void)
+{
+	HeadlessScreen *h = screenState();
+	int i;
+
+	h->frameNumber++;
+	if (h->dumpFile == NULL)
+		return;
+
+	fprintf(h->dumpFile, "--- frame %ld ---\n", h->frameNumber);
+	for (i = 0; i < h->SCR_HEIGHT; i++)
+	{
+		fwrite(h->screen + (size_t)i*h->SCR_WIDTH, 1, h->SCR_WIDTH, h->dumpFile);
+		fputc('\n', h->dumpFile);
+	}
+}
+
+static void headlessWaitForKey(void)
+{
+	/* nobody to press one */
+}
+
+static void headlessFinish(void)
+{
+	HeadlessScreen *h = screenState();
+
+	if (h == NULL)
+		return;
+	if (h->dumpFile != NULL)
+		fclose(h->dumpFile);
+	free(h->screen);
+	free(h);
+	currentSession()->backendState = NULL;
+}
+
+ConsoleBackend headlessBackend = {
+	headlessInit,
+	headlessDrawRow,
+	headlessPresent,
+	headlessWaitForKey,
+	headlessFinish
+};
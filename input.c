@@ -0,0 +1,245 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file reads the keyboard. The input thread sleeps in epoll on stdin and an eventfd, so it only wakes up when a key
+ * arrives or the game is shutting down. Every wakeup drains all the bytes waiting in a single read, stamps them, and
+ * queues them for the game loop, which applies them at the next tick boundary. Keys piped or redirected in rather than
+ * typed are a script, so every one of them is kept: the input thread waits for room in the queue instead of dropping
+ * them and repeats aren't collapsed. A file can't be watched by epoll, so it is read straight through instead. Server
+ * sessions have no input thread, the server feeds their keys in from their terminals.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "input.h"
+#include "gameglobals.h"
+#include "threadwrappers.h"
+#include "session.h"
+
+#define ACTION_QUEUE_SIZE 64
+#define READ_SIZE 64
+#define NSEC_PER_SEC 1000000000L
+
+/* The keys waiting for one session's game loop */
+typedef struct INPUT_STATE InputState;
+struct INPUT_STATE {
+   InputAction actionQueue[ACTION_QUEUE_SIZE];
+   int actionFront;
+   int actionCount;
+   pthread_mutex_t actionLock;
+   pthread_cond_t spaceFree; //signalled when a key is taken off a full queue
+   bool stopped;             //the game is over, nothing waits for room any more
+   int shutdownFd;
+};
+
+static enum inputPolicy keyPolicy = collapseRepeats;
+
+//---PROTOTYPES---------------------------------------------------------
+static void queueAction(int key, long readAt);
+static bool queueScript(const unsigned char *keys, int count, long readAt);
+static void pushAction(InputState *input, int key, long readAt);
+static void readUnpolled();
+static bool isMovementKey(int key);
+static InputState *state();
+//---METHODS------------------------------------------------------------//
+
+void setInputPolicy(enum inputPolicy policy){
+   keyPolicy = policy;
+}
+
+void initActionQueue(){
+   InputState *input = (InputState *)calloc(1, sizeof(InputState));
+   char name[32];
+   if(input == NULL){
+      printError();
+   }
+   input->shutdownFd = -1;
+   pthread_mutex_init(&input->actionLock, NULL);
+   pthread_cond_init(&input->spaceFree, NULL);
+   snprintf(name, sizeof(name), "s%d.actionLock", currentSession()->id);
+   nameLock(&input->actionLock, name);
+   currentSession()->input = input;
+}
+
+void initializeInput(){
+   initActionQueue();
+   state()->shutdownFd = eventfd(0, EFD_CLOEXEC);
+   if(state()->shutdownFd == -1){
+      printError();
+   }
+   startThread(readInput, NULL);
+}
+
+void *readInput(){
+   struct epoll_event event, ready[2];
+   unsigned char keys[READ_SIZE];
+   int shutdownFd = state()->shutdownFd;
+   int epollFd = epoll_create1(EPOLL_CLOEXEC);
+   bool reading = epollFd != -1;
+   bool typed = isatty(STDIN_FILENO);
+   int ret, count, i;
+
+   event.events = EPOLLIN;
+   event.data.fd = shutdownFd;
+   reading = reading && epoll_ctl(epollFd, EPOLL_CTL_ADD, shutdownFd, &event) == 0;
+   event.data.fd = STDIN_FILENO;
+   if(reading && epoll_ctl(epollFd, EPOLL_CTL_ADD, STDIN_FILENO, &event) != 0){
+      if(errno == EPERM){ //a regular file or /dev/null, which epoll can't watch
+         readUnpolled();
+      }
+      reading = false;
+   }
+
+   while(reading && !isGameOver()){
+      ret = epoll_wait(epollFd, ready, 2, -1);
+      if(ret == -1){
+         reading = errno == EINTR;
+      }
+      for(i = 0; i < ret && reading; i++){
+         if(ready[i].data.fd == shutdownFd){
+            reading = false;
+         }
+         else if((count = read(STDIN_FILENO, keys, READ_SIZE)) <= 0){
+            reading = false; //input closed (e.g. a headless run), the game goes on without it
+         }
+         else if(typed){
+            feedKeys(keys, count, inputClock());
+         }
+         else{
+            reading = queueScript(keys, count, inputClock());
+         }
+      }
+   }
+   if(epollFd != -1){
+      close(epollFd);
+   }
+   pthread_exit(NULL);
+}
+
+void feedKeys(const unsigned char *keys, int count, long readAt){
+   int i;
+   for(i = 0; i < count; i++){
+      if(keyPolicy == collapseRepeats && i > 0 && keys[i] == keys[i-1] && isMovementKey(keys[i])){
+         continue; //held key, one move per batch is enough
+      }
+      queueAction(keys[i], readAt);
+   }
+}
+
+bool takeAction(InputAction *action, long before){
+   InputState *input = state();
+   bool taken = false;
+   if(input == NULL){
+      return false;
+   }
+   lockMutex(&input->actionLock);
+   if(input->actionCount > 0 && input->actionQueue[input->actionFront].readAt <= before){
+      *action = input->actionQueue[input->actionFront];
+      input->actionFront = (input->actionFront + 1) % ACTION_QUEUE_SIZE;
+      input->actionCount--;
+      taken = true;
+      pthread_cond_signal(&input->spaceFree);
+   }
+   unlockMutex(&input->actionLock);
+   return taken;
+}
+
+void stopInput(){
+   uint64_t one = 1;
+   InputState *input = state();
+   if(input == NULL){
+      return;
+   }
+   lockMutex(&input->actionLock);
+   input->stopped = true;
+   pthread_cond_broadcast(&input->spaceFree);
+   unlockMutex(&input->actionLock);
+   if(input->shutdownFd != -1 && write(input->shutdownFd, &one, sizeof(one)) != sizeof(one)){
+      printError();
+   }
+}
+
+void deleteInput(){
+   InputState *input = state();
+   if(input != NULL){
+      if(input->shutdownFd != -1){
+         close(input->shutdownFd);
+      }
+      destroyMutex(&input->actionLock);
+      pthread_cond_destroy(&input->spaceFree);
+      free(input);
+      currentSession()->input = NULL;
+   }
+}
+
+long inputClock(){
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+/* Reads stdin with plain reads until it ends. Only for files epoll refuses,
+   which are always ready to read, so the only wait is for room in the queue */
+static void readUnpolled(){
+   unsigned char keys[READ_SIZE];
+   int count;
+   while(!isGameOver() && (count = read(STDIN_FILENO, keys, READ_SIZE)) > 0 &&
+         queueScript(keys, count, inputClock()));
+}
+
+static void queueAction(int key, long readAt){
+   InputState *input = state();
+   lockMutex(&input->actionLock);
+   if(input->actionCount < ACTION_QUEUE_SIZE){ //a full queue drops the key like a missed keypress
+      pushAction(input, key, readAt);
+   }
+   unlockMutex(&input->actionLock);
+}
+
+/* Queues every key of a script, as typed, waiting for the game loop to make
+   room when the queue is full. Returns false once the game is over */
+static bool queueScript(const unsigned char *keys, int count, long readAt){
+   InputState *input = state();
+   bool stopped;
+   int i;
+   lockMutex(&input->actionLock);
+   for(i = 0; i < count && !input->stopped; i++){
+      while(input->actionCount == ACTION_QUEUE_SIZE && !input->stopped){
+         pthread_cond_wait(&input->spaceFree, &input->actionLock);
+      }
+      if(!input->stopped){
+         pushAction(input, keys[i], readAt);
+      }
+   }
+   stopped = input->stopped;
+   unlockMutex(&input->actionLock);
+   return !stopped;
+}
+
+/* Adds a key to the back of the queue. The caller holds the lock and has
+   checked there is room */
+static void pushAction(InputState *input, int key, long readAt){
+   InputAction *slot = &input->actionQueue[(input->actionFront + input->actionCount) % ACTION_QUEUE_SIZE];
+   slot->key = key;
+   slot->readAt = readAt;
+   input->actionCount++;
+}
+
+static bool isMovementKey(int key){
+   return key == LEFT_KEY || key == RIGHT_KEY || key == UP_KEY || key == DOWN_KEY;
+}
+
+static InputState *state(){
+   return currentSession()->input;
+}
@@ -0,0 +1,52 @@
+/* The header file for input.c
+*/
+
+#ifndef INPUT_H
+#define INPUT_H
+#include <stdbool.h>
+
+enum inputPolicy {keepAllKeys, collapseRepeats};
+
+typedef struct INPUT_ACTION InputAction;
+struct INPUT_ACTION {
+   int key;
+   long readAt; //monotonic ns when the key was read
+};
+
+/* Picks what happens to repeated movement keys. With collapseRepeats (the
+   default), a run of the same movement key in one read (a held key) is queued
+   once. Call before initializeInput */
+void setInputPolicy(enum inputPolicy policy);
+
+/* Sets up the current session's action queue, with no input thread */
+void initActionQueue();
+
+/* Sets up the action queue and shutdown eventfd and creates the input thread
+   reading stdin */
+void initializeInput();
+
+/* Queues `count' keys read at `readAt' for the current session, collapsing
+   held keys according to the input policy */
+void feedKeys(const unsigned char *keys, int count, long readAt);
+
+/* Input thread. Sleeps in epoll until keys arrive or the game shuts down, then
+   drains everything waiting in one read and queues it. Keys that don't come
+   from a terminal are all kept, uncollapsed, waiting for room in the queue,
+   and stdin redirected from a file is read straight through */
+void *readInput();
+
+/* Takes the oldest queued action read no later than `before' (monotonic ns).
+   Returns false if there is none */
+bool takeAction(InputAction *action, long before);
+
+/* Wakes the input thread so it can exit, even if it's waiting for room in the
+   queue */
+void stopInput();
+
+/* Frees the current session's action queue once its input thread is gone */
+void deleteInput();
+
+/* Current monotonic time in ns, the clock actions are stamped with */
+long inputClock();
+
+#endif
@@ -0,0 +1,345 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file holds the logs, one ring buffer per lane. Logs in a lane enter at one edge and leave at the other in the order
+ * they were spawned, so the ring is always ordered by position: new logs go on the back and dead logs come off the front.
+ * Every lane has its own lock so looking up or cleaning up one lane never waits on another. Logs come from a fixed size
+ * pool so spawning never calls malloc. A log that dies is unlinked at once and goes back to the pool through epoch.c,
+ * once nobody can still be holding it. Every lane also keeps a bitboard of the columns its logs can carry the frog over,
+ * kept up to date a column at a time as logs move, so finding out whether the frog is on a log never walks the lane.
+ * Logs in a lane never overlap, so each bit belongs to at most one log. What every log needs every tick, its fixed
+ * point column and velocity, is kept apart from the logs in arrays slot for slot with the ring (logmotion.c), so one
+ * vector pass moves the whole lane and only the logs that reach a new column are touched.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <pthread.h>
+#include "lanes.h"
+#include "log.h"
+#include "pool.h"
+#include "epoch.h"
+#include "threadwrappers.h"
+#include "session.h"
+
+/* The lanes of one session and the pool their logs come from */
+typedef struct LANE_STATE LaneState;
+struct LANE_STATE {
+   Lane *lanes;
+   int numLanes;
+   Pool logPool;
+   pthread_mutex_t poolLock;
+};
+
+//---PROTOTYPES---------------------------------------------------------
+static Log *slotAt(Lane *lane, int index);
+static int slotIndex(Lane *lane, int index);
+static void copyMotion(LogMotion *motion, int to, int from);
+static int stepSlots(Lane *lane, int first, int count, Log *due[], int toCols[], unsigned char flags[]);
+static bool overlaps(Log *log, int fromCol, int toCol);
+static bool pastRange(Log *log, int fromCol, int toCol);
+static bool unlinkLog(Lane *lane, Log *log);
+static void reclaimLog(void *item);
+static void markLog(Lane *lane, Log *log, bool set);
+static LaneState *state();
+//---METHODS------------------------------------------------------------//
+
+bool initLanes(int rows[], int count, int cols, int capacity){
+   LaneState *lanes = (LaneState *)calloc(1, sizeof(LaneState));
+   bool success = true;
+   char name[32];
+   int i;
+
+   if(lanes == NULL){
+      return false;
+   }
+   lanes->lanes = (Lane *)calloc(count, sizeof(Lane));
+   if(lanes->lanes == NULL || !poolInit(&lanes->logPool, sizeof(Log), count*capacity) ||
+      !initEpochs(count*capacity, reclaimLog)){
+      destroyEpochs(); //whatever initEpochs got to before it failed
+      poolDestroy(&lanes->logPool);
+      free(lanes->lanes);
+      free(lanes);
+      return false;
+   }
+   currentSession()->lanes = lanes;
+   pthread_mutex_init(&lanes->poolLock, NULL);
+   snprintf(name, sizeof(name), "s%d.logPoolLock", currentSession()->id);
+   nameLock(&lanes->poolLock, name);
+   for(i = 0; i < count && success; i++){
+      lanes->lanes[i].logs = (Log **)malloc(capacity*sizeof(Log *));
+      success = lanes->lanes[i].logs != NULL && bitboardInit(&lanes->lanes[i].carries, cols) &&
+         logMotionInit(&lanes->lanes[i].motion, capacity, cols);
+      lanes->lanes[i].row = rows[i];
+      lanes->lanes[i].capacity = capacity;
+      lanes->lanes[i].front = 0;
+      lanes->lanes[i].count = 0;
+      pthread_mutex_init(&lanes->lanes[i].lock, NULL);
+      snprintf(name, sizeof(name), "s%d.lane%dLock", currentSession()->id, i);
+      nameLock(&lanes->lanes[i].lock, name);
+      lanes->numLanes++;
+   }
+   if(!success){
+      deleteLanes();
+   }
+   return success;
+}
+
+int laneCount(){
+   return state() == NULL ? 0 : state()->numLanes;
+}
+
+Lane *laneAt(int index){
+   return &state()->lanes[index];
+}
+
+Lane *laneForRow(int row){
+   Lane *lanes = state()->lanes;
+   Lane *lane = NULL;
+   int i;
+   for(i = 0; i < state()->numLanes && lane == NULL; i++){
+      if(row >= lanes[i].row && row < lanes[i].row + LOG_HEIGHT){
+         lane = &lanes[i];
+      }
+   }
+   return lane;
+}
+
+Log *allocLog(){
+   LaneState *lanes = state();
+   Log *log;
+   lockMutex(&lanes->poolLock);
+   log = (Log *)poolAlloc(&lanes->logPool);
+   unlockMutex(&lanes->poolLock);
+   return log;
+}
+
+void freeLog(Log *log){
+   LaneState *lanes = state();
+   lockMutex(&lanes->poolLock);
+   poolFree(&lanes->logPool, log);
+   unlockMutex(&lanes->poolLock);
+}
+
+bool laneInsert(Lane *lane, Log *log){
+   LogMotion *motion = &lane->motion;
+   bool success = false;
+   int slot;
+   if(log != NULL && lane->count < lane->capacity && log->currCol >= -MAX_FIXED_COL && log->currCol <= MAX_FIXED_COL){
+      slot = slotIndex(lane, lane->count);
+      lane->logs[slot] = log;
+      motion->pos[slot] = toFixed(log->currCol);
+      motion->step[slot] = log->direction == left ? -log->velocity : log->velocity;
+      motion->col[slot] = log->currCol;
+      motion->minCol[slot] = LEFT_EDGE - log->width;
+      motion->flags[slot] = 0;
+      lane->count++;
+      log->lane = lane;
+      markLog(lane, log, true);
+      success = true;
+   }
+   return success;
+}
+
+bool laneRemove(Lane *lane, Log *log){
+   bool deleted = unlinkLog(lane, log);
+   if(deleted){
+      freeLog(log);
+   }
+   return deleted;
+}
+
+bool laneRetire(Lane *lane, Log *log){
+   bool retired = unlinkLog(lane, log);
+   if(retired){
+      epochRetire(log);
+   }
+   return retired;
+}
+
+int laneStepMotion(Lane *lane, Log *due[], int toCols[], unsigned char flags[]){
+   int wrapped = lane->front + lane->count - lane->capacity; //slots used at the start of the ring
+   int count;
+
+   if(wrapped > 0){
+      count = stepSlots(lane, lane->front, lane->count - wrapped, due, toCols, flags);
+      count += stepSlots(lane, 0, wrapped, due + count, toCols + count, flags + count);
+   }
+   else{
+      count = stepSlots(lane, lane->front, lane->count, due, toCols, flags);
+   }
+   return count;
+}
+
+int laneLogPos(Lane *lane, int index){
+   return lane->motion.pos[slotIndex(lane, index)];
+}
+
+void laneSetLogPos(Lane *lane, int index, int pos){
+   int slot = slotIndex(lane, index);
+   lane->motion.pos[slot] = pos;
+   lane->motion.col[slot] = pos >> FIX_SHIFT;
+}
+
+void laneShiftLog(Lane *lane, Log *log){
+   if(log->currCol > log->prevCol){ //right, the back edge moves off a column and the front edge onto one
+      bitboardSetRange(&lane->carries, log->prevCol+1, log->prevCol+1, false);
+      bitboardSetRange(&lane->carries, log->currCol+log->width-2, log->currCol+log->width-2, true);
+   }
+   else{
+      bitboardSetRange(&lane->carries, log->prevCol+log->width-2, log->prevCol+log->width-2, false);
+      bitboardSetRange(&lane->carries, log->currCol+1, log->currCol+1, true);
+   }
+}
+
+bool laneCarries(Lane *lane, int fromCol, int toCol){
+   return bitboardAll(&lane->carries, fromCol, toCol);
+}
+
+Log *laneFront(Lane *lane){
+   Log *front = NULL;
+   if(lane->count > 0){
+      front = slotAt(lane, 0);
+   }
+   return front;
+}
+
+void laneIterInit(LaneIter *iter, Lane *lane){
+   iter->lane = lane;
+   iter->index = 0;
+   iter->fromCol = INT_MIN;
+   iter->toCol = INT_MAX;
+}
+
+void laneIterRange(LaneIter *iter, Lane *lane, int fromCol, int toCol){
+   iter->lane = lane;
+   iter->index = 0;
+   iter->fromCol = fromCol;
+   iter->toCol = toCol;
+}
+
+Log *laneIterNext(LaneIter *iter){
+   Log *next = NULL;
+   Log *curr;
+   while(next == NULL && iter->index < iter->lane->count){
+      curr = slotAt(iter->lane, iter->index++);
+      if(overlaps(curr, iter->fromCol, iter->toCol)){
+         next = curr;
+      }
+      else if(pastRange(curr, iter->fromCol, iter->toCol)){
+         iter->index = iter->lane->count; //the rest of the lane is even further away
+      }
+   }
+   return next;
+}
+
+void deleteLanes(){
+   LaneState *lanes = state();
+   int i;
+   if(lanes == NULL){
+      return;
+   }
+   for(i = 0; i < lanes->numLanes; i++){
+      free(lanes->lanes[i].logs);
+      bitboardFree(&lanes->lanes[i].carries);
+      logMotionFree(&lanes->lanes[i].motion);
+      destroyMutex(&lanes->lanes[i].lock);
+   }
+   destroyEpochs();
+   poolDestroy(&lanes->logPool);
+   destroyMutex(&lanes->poolLock);
+   free(lanes->lanes);
+   free(lanes);
+   currentSession()->lanes = NULL;
+}
+
+static Log *slotAt(Lane *lane, int index){
+   return lane->logs[slotIndex(lane, index)];
+}
+
+/* Ring slot of the lane's `index'th log */
+static int slotIndex(Lane *lane, int index){
+   return (lane->front + index) % lane->capacity;
+}
+
+/* Runs the motion kernel over `count' ring slots that don't wrap and picks out the due logs */
+static int stepSlots(Lane *lane, int first, int count, Log *due[], int toCols[], unsigned char flags[]){
+   LogMotion *motion = &lane->motion;
+   int numDue = 0;
+   int slot;
+
+   logMotionStep(motion, first, count);
+   for(slot = first; slot < first + count; slot++){
+      if(motion->flags[slot] & MOTION_DUE){
+         due[numDue] = lane->logs[slot];
+         toCols[numDue] = motion->col[slot];
+         flags[numDue] = motion->flags[slot];
+         numDue++;
+      }
+   }
+   return numDue;
+}
+
+static void copyMotion(LogMotion *motion, int to, int from){
+   motion->pos[to] = motion->pos[from];
+   motion->step[to] = motion->step[from];
+   motion->col[to] = motion->col[from];
+   motion->minCol[to] = motion->minCol[from];
+   motion->flags[to] = motion->flags[from];
+}
+
+static bool overlaps(Log *log, int fromCol, int toCol){
+   return log->currCol <= toCol && log->currCol + log->width - 1 >= fromCol;
+}
+
+/* Logs behind the front are further from the exit edge, so once one log is
+   past the range on the entry side every later one is too */
+static bool pastRange(Log *log, int fromCol, int toCol){
+   bool past;
+   if(log->direction == left)
+      past = log->currCol > toCol;
+   else
+      past = log->currCol + log->width - 1 < fromCol;
+   return past;
+}
+
+static bool unlinkLog(Lane *lane, Log *log){
+   bool unlinked = false;
+   int i;
+
+   for(i = 0; i < lane->count && slotAt(lane, i) != log; i++);
+
+   if(i < lane->count){
+      if(i == 0){ //the usual case, oldest log went off the far edge
+         lane->front = (lane->front + 1) % lane->capacity;
+      }
+      else{
+         for(; i < lane->count-1; i++){
+            lane->logs[slotIndex(lane, i)] = slotAt(lane, i+1);
+            copyMotion(&lane->motion, slotIndex(lane, i), slotIndex(lane, i+1));
+         }
+      }
+      lane->count--;
+      markLog(lane, log, false);
+      log->lane = NULL;
+      unlinked = true;
+   }
+   return unlinked;
+}
+
+static void reclaimLog(void *item){
+   freeLog((Log *)item);
+}
+
+/* A log carries the frog everywhere but its first and last column */
+static void markLog(Lane *lane, Log *log, bool set){
+   bitboardSetRange(&lane->carries, log->currCol+1, log->currCol+log->width-2, set);
+}
+
+static LaneState *state(){
+   return currentSession()->lanes;
+}
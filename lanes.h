@@ -0,0 +1,103 @@
+/* The header file for lanes.c
+*/
+
+#ifndef LANES_H
+#define LANES_H
+#include <stdbool.h>
+#include <pthread.h>
+#include "log.h"
+#include "bitboard.h"
+#include "logmotion.h"
+
+typedef struct LANE Lane;
+struct LANE {
+   pthread_mutex_t lock;
+   int row;       //top row of the lane
+   Log **logs;    //ring buffer ordered by position, front is the oldest log
+   int capacity;
+   int front;
+   int count;
+   Bitboard carries; //columns a log can carry the frog over, the log minus its edge columns
+   LogMotion motion; //where each log is going this tick, slot for slot with `logs'
+};
+
+/* Caller owned cursor over one lane. Only valid while the lane lock is held */
+typedef struct LANE_ITER LaneIter;
+struct LANE_ITER {
+   Lane *lane;
+   int index;
+   int fromCol, toCol;
+};
+
+/* Creates one lane for each of the `numLanes' rows of the current session,
+   `cols' columns wide and each holding up to `capacity' logs, and the pool that owns all of their logs */
+bool initLanes(int rows[], int numLanes, int cols, int capacity);
+
+/* Returns the number of lanes */
+int laneCount();
+
+/* Returns the lane at the given index */
+Lane *laneAt(int index);
+
+/* Returns the lane covering the given screen row, NULL if the row is not water */
+Lane *laneForRow(int row);
+
+/* Takes a log from the log pool. Returns NULL if every log is in use */
+Log *allocLog();
+
+/* Returns a log to the log pool */
+void freeLog(Log *log);
+
+/* Adds a freshly spawned log to the back of the lane. Caller holds the lane
+   lock. Returns false if the lane is full or the log's column doesn't fit in
+   fixed point */
+bool laneInsert(Lane *lane, Log *log);
+
+/* Removes a log from the lane and returns it to the pool. Logs leave from the
+   front, which is O(1). Caller holds the lane lock and no one else may still
+   be holding the log */
+bool laneRemove(Lane *lane, Log *log);
+
+/* Removes a log from the lane right away but only returns it to the pool once
+   every reader that might be holding it has left its epoch. Caller holds the
+   lane lock */
+bool laneRetire(Lane *lane, Log *log);
+
+/* Steps every log in the lane one tick in one pass over the lane's motion
+   arrays. Fills `due' with the logs that reached a new column, oldest first,
+   `toCols' with that column and `flags' with MOTION_DEAD for the ones that are
+   off the board there, and returns how many. Caller holds the lane lock */
+int laneStepMotion(Lane *lane, Log *due[], int toCols[], unsigned char flags[]);
+
+/* Returns the fixed point column of the lane's `index'th log, oldest first */
+int laneLogPos(Lane *lane, int index);
+
+/* Sets the fixed point column of the lane's `index'th log, to put a saved log
+   back exactly where it was. A log is put at the start of its column when it
+   goes into the lane */
+void laneSetLogPos(Lane *lane, int index, int pos);
+
+/* Moves the log's columns in the lane's bitboard after moveLog stepped it one
+   column. Only the game loop moves logs, so this doesn't need the lane lock */
+void laneShiftLog(Lane *lane, Log *log);
+
+/* Returns true if a log in the lane is under every one of columns `fromCol' to
+   `toCol'. Constant time, whatever the number of logs */
+bool laneCarries(Lane *lane, int fromCol, int toCol);
+
+/* Returns the oldest log in the lane, NULL if the lane is empty */
+Log *laneFront(Lane *lane);
+
+/* Starts a traversal of every log in the lane, oldest first */
+void laneIterInit(LaneIter *iter, Lane *lane);
+
+/* Starts a traversal of the logs overlapping columns `fromCol' to `toCol' */
+void laneIterRange(LaneIter *iter, Lane *lane, int fromCol, int toCol);
+
+/* Continues a traversal. Returns NULL when there are no more logs */
+Log *laneIterNext(LaneIter *iter);
+
+/* Cleans up every lane and the log pool at end of program */
+void deleteLanes();
+
+#endif
@@ -16,74 +16,127 @@
 #include "console.h"
 #include "threadwrappers.h"
 #include "gameglobals.h"
-#include "llist.h"
+#include "lanes.h"
 #include "player.h"
+#include "events.h"
+#include "epoch.h"
+#include "session.h"
+#include "trace.h"
 
-#define LOG_ANIM_TILES 2 
-#define LOG_HEIGHT 4
-#define NUM_ROWS 4
-
-Frog *frog;
-static int log_width;
-static char* LOG_GRAPHIC[LOG_ANIM_TILES][LOG_HEIGHT+1] = {
-   {"/======================\\",
-    "|                      |",
-    "|                      |",
-   "\\======================/"},
-   {"/======================\\",
-    "-                      +",
-    "+                      -",
-   "\\======================/"}
+#define MIN_SPAWN_TICKS 150
+#define SPAWN_TICKS_RANGE 200
+#define LOG_STEP 2 //columns a log moves between animation frames
+
+/* A log moves `cols' columns every `ticks' ticks, any ratio works */
+typedef struct LANE_SPEED LaneSpeed;
+struct LANE_SPEED {
+   int cols, ticks;
+};
+static const LaneSpeed LANE_SPEEDS[] = {{2, 5}, {2, 7}, {2, 10}, {2, 12}}; //repeating down the board
+/* The spawn schedule of every lane in one session */
+typedef struct LOG_STATE LogState;
+struct LOG_STATE {
+   LaneSchedule schedules[MAX_LANES];
+   int numLanes;
 };
+
 //---PROTOTYPES------------------------------------------------//
+static LogState *state();
 static void drawLog();
-static void setLogWidth();
+static int nextSpawnDelay(LaneSchedule *lane);
+static const LaneSpeed *laneSpeed(int row);
+static int laneCapacity();
 //---METHODS---------------------------------------------------//
-void initializeLogs(){
-   frog = getFrog();
-   setLogWidth();
-
-   enum row rows[] = {one, two, three, four};
+void initializeLogs(unsigned int seed){
+   LaneSchedule *schedules;
+   int numLanes = boardLanes();
+   if((currentSession()->logs = (LogState *)calloc(1, sizeof(LogState))) == NULL){
+      printError();
+   }
+   schedules = state()->schedules;
+   state()->numLanes = numLanes;
+   int rows[numLanes];
    int i;
-   for(i = 0; i < NUM_ROWS; i++){
-      void *row = malloc(sizeof(int));
-      *((int*)row) = rows[i];
-      createThread(&tids[getThreadCount()], runLogs, (void *)row);
+   for(i = 0; i < numLanes; i++){
+      rows[i] = laneRow(i);
+   }
+   if(!initLanes(rows, numLanes, boardCols(), laneCapacity())){
+      printError();
    }
 
-   createThread(&tids[getThreadCount()], cleanUpLogs, NULL);
+   for(i = 0; i < numLanes; i++){
+      schedules[i].lane = laneAt(i);
+      schedules[i].row = rows[i];
+      schedules[i].ticksToSpawn = 0; //first log of every lane spawns right away
+      schedules[i].rng = (seed ^ ((i+1) * 0x9E3779B9u)) | 1; //xorshift state can't be 0
+   }
 }
 
-void *runLogs(void *startRow){
-   int *row = (int *)startRow;
-   while(!isGameOver()){
-      Log *newLog = (Log *)malloc(sizeof(Log));
-      logStartup(newLog, row);
-      lockMutex(&listLock);
-      insert(newLog);
-      unlockMutex(&listLock);
+void stepLanes(){
+   LaneSchedule *schedules = state()->schedules;
+   int i;
+   for(i = 0; i < state()->numLanes; i++){
+      if(--schedules[i].ticksToSpawn <= 0){
+         spawnLog(&schedules[i]);
+         schedules[i].ticksToSpawn = nextSpawnDelay(&schedules[i]);
+      }
+      stepLogs(schedules[i].lane);
+   }
+}
 
-      createLogThread(&(newLog->threadID), logController, (void *)newLog);
-      sleepTicks((rand()%200)+150); //random log generation speed
-     }
-   pthread_exit(NULL);
+void spawnLog(LaneSchedule *lane){
+   Log *newLog = allocLog();
+   if(newLog != NULL){ //pool is sized for the busiest lanes, a full pool skips this spawn
+      logStartup(newLog, &lane->row);
+      lockMutex(&lane->lane->lock);
+      if(!laneInsert(lane->lane, newLog)){
+         freeLog(newLog);
+      }
+      unlockMutex(&lane->lane->lock);
+   }
 }
 
-void *logController(void *currLog){
-   Log *log = (Log *)currLog; 
-   while(!isGameOver() && !log->dead){
-      if(log->hasFrog){
-	 moveFrogAndLog(log);
-	 moveFrogAndLog(log);
+void stepLogs(Lane *lane){
+   Log *due[lane->capacity];
+   int toCols[lane->capacity];
+   unsigned char flags[lane->capacity];
+   Log *curr = NULL;
+   int count;
+   int reader;
+   int i;
+
+   //move the whole lane in one pass and take the logs that reached a new column, so
+   //its lock isn't held while the frog moves with a log. The epoch keeps logs
+   //retired meanwhile out of the pool until we're done
+   traceBegin("stepLogs");
+   reader = epochEnter();
+   lockMutex(&lane->lock);
+   count = laneStepMotion(lane, due, toCols, flags);
+   unlockMutex(&lane->lock);
+
+   for(i = 0; i < count && !isGameOver(); i++){
+      curr = due[i];
+      logController(curr, toCols[i]);
+      if(flags[i] & MOTION_DEAD){ //went off the edge, gone from the lane as of now
+         lockMutex(&lane->lock);
+         laneRetire(lane, curr);
+         unlockMutex(&lane->lock);
+         publishEvent(logRetired, lane->row);
       }
-      else{
-         moveLog(log);
+   }
+   epochExit(reader);
+   traceEnd();
+}
+
+void logController(Log *log, int toCol){
+   traceBegin("logController");
+   while(log->currCol != toCol && !log->dead){
+      if(log->hasFrog)
+         moveFrogAndLog(log);
+      else
          moveLog(log);
-         animateLog(log);
-      }
-      sleepTicks(log->speed);
    }
-   pthread_exit(NULL);
+   traceEnd();
 }
 
 void moveLog(Log *log){
@@ -95,82 +148,76 @@ void moveLog(Log *log){
       log->prevCol = log->currCol;
       log->currCol++;
    }
+   log->animateState = ((log->currCol / LOG_STEP) & 1) ? second : first;
+   if(log->lane != NULL){
+      laneShiftLog(log->lane, log);
+   }
    drawLog(log);
    checkIsDead(log);
 }
 
-void animateLog(Log *log){
-   if(log->animateState == first)
-      log->animateState = second;
-   else
-      log->animateState = first;
-   drawLog(log);
+static void drawLog(Log *log){
+   int fromCol = log->prevCol < log->currCol ? log->prevCol : log->currCol;
+   int span = abs(log->currCol - log->prevCol) + log->width;
+
+   if(!consoleInView(log->startRow, fromCol, LOG_HEIGHT, span)){
+      return; //still simulated, just not drawn until the view gets to it
+   }
+   traceBegin("drawLog");
+   consoleBeginUpdate();
+   consoleClearImage(log->startRow, log->prevCol, log->height, log->width);
+   consoleDrawImage(log->startRow, log->currCol, &logSprite, log->animateState);
+   consoleEndUpdate();
+   traceEnd();
 }
 
-static void drawLog(Log *log){
-   char** tile = LOG_GRAPHIC[log->animateState];
-   
-   lockMutex(&screenLock);
-   consoleClearImage(log->startRow, log->prevCol, LOG_HEIGHT, log_width);
-   consoleDrawImage(log->startRow, log->currCol, tile, LOG_HEIGHT);
-   unlockMutex(&screenLock);
+void drawVisibleLogs(){
+   int top, left, height, width;
+   LaneIter iter;
+   Lane *lane;
+   Log *log;
+   int i;
+
+   consoleViewport(&top, &left, &height, &width);
+   for(i = 0; i < laneCount(); i++){
+      lane = laneAt(i);
+      if(lane->row + LOG_HEIGHT <= top || lane->row >= top + height){
+         continue;
+      }
+      lockMutex(&lane->lock);
+      laneIterRange(&iter, lane, left, left + width - 1);
+      while((log = laneIterNext(&iter)) != NULL){
+         consoleDrawImage(log->startRow, log->currCol, &logSprite, log->animateState);
+      }
+      unlockMutex(&lane->lock);
+   }
 }
 
 void moveFrogAndLog(Log *log){
    moveLog(log);
-   animateLog(log);
    if(log->direction == left)
       moveFrog(LEFT_KEY);
    else
       moveFrog(RIGHT_KEY);
 }
 
-void *cleanUpLogs(){
-   Log *curr = NULL;
-   Log *logToDelete = NULL;
-   while(!isGameOver()){
-      lockMutex(&listLock);
-      curr = cleanupNextLog();
-      unlockMutex(&listLock);
-      while(curr != NULL && !isGameOver()){
-         if(curr->dead){
-            joinLogThread(curr->threadID);
-            logToDelete = curr;
-         }
-
-         if(logToDelete != NULL){
-            lockMutex(&listLock);
-            searchAndRemove(logToDelete);
-            unlockMutex(&listLock);
-            logToDelete = NULL;
-         }
-         lockMutex(&listLock);
-         curr = cleanupNextLog();
-         unlockMutex(&listLock);
-	 sleepTicks(1);
-      }
-      unlockMutex(&listLock);
-      sleepLoop(100);
-   }
-   pthread_exit(NULL);
-}
-
 void logStartup(Log *log, int *startRow){ 
-   log->startRow = (enum row)*startRow;
+   log->startRow = *startRow;
    setLogSpeed(log, startRow);
    setDirection(log);
-   log->width = log_width;
-   log->height = LOG_HEIGHT;
+   log->width = logSprite.width;
+   log->height = logSprite.height;
    log->animateState = first;
 
    if(log->direction == left){
-      log->prevCol = log->currCol = RIGHT_EDGE;
+      log->prevCol = log->currCol = boardCols();
    }
    else{
       log->prevCol = log->currCol = LEFT_EDGE-log->width;
    }
    log->dead = false;
    log->hasFrog = false;
+   log->lane = NULL;
 }
 
 void setDirection(Log *log){
@@ -181,25 +228,60 @@ void setDirection(Log *log){
 }
 
 void setLogSpeed(Log *log, int *startRow){
-   enum row currRow = (enum row)*startRow;
-   if(currRow == one)
-      log->speed = 5;
-   else if(currRow == two)
-      log->speed = 7;
-   else if(currRow == three)
-      log->speed = 10; 
-   else
-      log->speed = 12;
+   const LaneSpeed *speed = laneSpeed(*startRow);
+   log->velocity = toFixed(speed->cols) / speed->ticks;
+}
+
+static const LaneSpeed *laneSpeed(int row){
+   int lane = (row - SAFE_BANK) / LOG_HEIGHT;
+   return &LANE_SPEEDS[lane % (sizeof(LANE_SPEEDS)/sizeof(LANE_SPEEDS[0]))];
+}
+
+/* Most logs a lane can hold at once is the time a log takes to cross the screen
+   over the shortest spawn gap. Sized for the slowest lane and doubled so retired
+   logs still waiting out their epoch never starve a spawn */
+static int laneCapacity(){
+   const LaneSpeed *speed;
+   int crossTicks;
+   int capacity = 0;
+   int i;
+   for(i = 0; i < boardLanes(); i++){
+      speed = laneSpeed(laneRow(i));
+      crossTicks = (boardCols() + logSprite.width) * speed->ticks / speed->cols;
+      if(2 * (crossTicks / MIN_SPAWN_TICKS + 2) > capacity){
+         capacity = 2 * (crossTicks / MIN_SPAWN_TICKS + 2);
+      }
+   }
+   return capacity;
 }
 
 void checkIsDead(Log *log){
-   if(log->currCol > RIGHT_EDGE || log->currCol < LEFT_EDGE-log->width){
+   if(log->currCol > boardCols() || log->currCol < LEFT_EDGE-log->width){
       log->dead = true;
    }
 }
 
-void setLogWidth(){
-   char **tile = LOG_GRAPHIC[0];
-   log_width = strlen(tile[0]);
+/* Each lane has its own xorshift generator seeded from the game seed, so spawns
+   replay the same no matter which order lanes are stepped in */
+static int nextSpawnDelay(LaneSchedule *lane){
+   unsigned int x = lane->rng;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   lane->rng = x;
+   return (x%SPAWN_TICKS_RANGE)+MIN_SPAWN_TICKS; //random log generation speed
+}
+
+LaneSchedule *laneSchedule(int lane){
+   return &state()->schedules[lane];
 }
 
+void deleteLogs(){
+   deleteLanes();
+   free(state());
+   currentSession()->logs = NULL;
+}
+
+static LogState *state(){
+   return currentSession()->logs;
+}
@@ -4,47 +4,68 @@
 #ifndef LOG_H
 #define LOG_H
 #include <stdbool.h>
+#include <limits.h>
 #include <pthread.h>
 #include "gameglobals.h"
 
+#define LOG_HEIGHT LANE_HEIGHT //logs fill their lane, the log sprite is this tall
+#define FIX_SHIFT 16 //log positions and speeds are fixed point with this many fraction bits
+#define toFixed(cols) ((cols) * (1 << FIX_SHIFT)) //multiplied, shifting a negative column left is undefined
+#define MAX_FIXED_COL (INT_MAX / (1 << FIX_SHIFT)) //columns further out than this don't fit in fixed point
+
 enum logDirection {left, right};
-enum row {
-   one = 4,
-   two = 8,
-   three = 12,
-   four = 16,
-};
 
 typedef struct LOG Log;
 struct LOG {
-   pthread_t threadID;
-   int speed;
+   int velocity; //columns per tick, fixed point. Its lane keeps the fixed point column
    int prevCol, currCol;
    bool dead;
    int width;
    bool hasFrog;
    int height;
-   enum row startRow;
+   int startRow;
    enum logDirection direction;
    enum state animateState;
+   struct LANE *lane; //lane the log is in, NULL once it's been taken out
 };
 
-/* Creates log spawner for each row */
-void initializeLogs();
+typedef struct LANE_SCHEDULE LaneSchedule;
+struct LANE_SCHEDULE {
+   int row;
+   int ticksToSpawn;
+   unsigned int rng;
+   struct LANE *lane;
+};
 
-/* Manages the logs for each row. Adds logs to the list and initializes logs with 
-   start values */ 
-void *runLogs(void *startRow);
+/* Sets up the lanes and their spawn schedules, seeding each lane's spawn
+   generator from `seed' */
+void initializeLogs(unsigned int seed);
 
-/* Decides whether to move the log by itself or the frog with the log, also sets
-   log speed */
-void *logController(void *currLog);
+/* Returns the spawn schedule of the given lane */
+LaneSchedule *laneSchedule(int lane);
 
-/* Moves log in the correct direction and checks if it's offscreen */
-void moveLog(Log *log);
+/* Frees the lanes, their logs and the spawn schedules at the end of the game */
+void deleteLogs();
+
+/* Called by the game loop once per tick. Spawns logs from the per-lane
+   schedule and steps every log */
+void stepLanes();
 
-/* Sets animate state for the log */
-void animateLog(Log *log);
+/* Adds a new log with start values to the list for the given lane */
+void spawnLog(LaneSchedule *lane);
+
+/* Steps every live log in the lane once. Only the logs that reached a new
+   column are moved, and the ones that went off screen are retired from the
+   lane right away */
+void stepLogs(struct LANE *lane);
+
+/* Moves the log to `toCol' a column at a time and takes the frog along if
+   it's on it. Called by stepLogs when the log's velocity took it to a new column */
+void logController(Log *log, int toCol);
+
+/* Moves log one column in the correct direction, picks its animation frame
+   from the column and checks if it's offscreen */
+void moveLog(Log *log);
 
 /* Sets up log with default attributes */ 
 void logStartup(Log *log, int *startRow);
@@ -52,15 +73,14 @@ void logStartup(Log *log, int *startRow);
 /* Sets direction of log movement depending on row number */
 void setDirection(Log *log);
 
-/* Sets log speed based on current row */
+/* Sets log velocity based on current row */
 void setLogSpeed(Log *log, int *startRow);
 
-/* Checks if log is offscreen */
+/* Checks if log went off the board */
 void checkIsDead(Log *log);
 
-/* Traverses linked list to check for dead logs and cleans up associated memory.
-   Also joins threads before deleting log */
-void *cleanUpLogs();
+/* Draws every log in view, after the view scrolled */
+void drawVisibleLogs();
 
 /* Calls moveLog and moveFrog methods together */
 void moveFrogAndLog(Log *log);
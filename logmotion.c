@@ -0,0 +1,147 @@
+/**********************************************************************
+  Module: logmotion.c
+
+  Purpose: Structure of arrays motion for the logs of a lane and the
+	   kernels that step it. see logmotion.h
+
+  NOTES: like blit.c the AVX2 kernel is compiled with a target
+	 attribute and SSE2 is always there on x86-64. Each kernel does
+	 four (SSE2) or eight (AVX2) logs at a time and finishes the
+	 last few with the scalar one, since the slots past the lane's
+	 logs may belong to nobody.
+**********************************************************************/
+
+#include "logmotion.h"
+#include "blit.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define MOTION_X86
+#include <immintrin.h>
+#endif
+
+/* Local functions */
+
+/****************************** scalar ******************************/
+
+static void scalarStep(LogMotion *m, int first, int count)
+{
+	int i, col;
+
+	for (i = first; i < first + count; i++)
+	{
+		m->pos[i] += m->step[i];
+		col = m->pos[i] >> FIX_SHIFT;	/* arithmetic shift, floors negative positions too */
+		m->flags[i] = (col != m->col[i] ? MOTION_DUE : 0) |
+			(col > m->maxCol || col < m->minCol[i] ? MOTION_DEAD : 0);
+		m->col[i] = col;
+	}
+}
+
+#ifdef MOTION_X86
+
+/******************************* SSE2 *******************************/
+
+static void sse2Step(LogMotion *m, int first, int count)
+{
+	__m128i maxCol = _mm_set1_epi32(m->maxCol);
+	__m128i due = _mm_set1_epi32(MOTION_DUE);
+	__m128i dead = _mm_set1_epi32(MOTION_DEAD);
+	__m128i pos, col, flags;
+	int packed;
+	int i;
+
+	for (i = first; i + 4 <= first + count; i += 4)
+	{
+		pos = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(m->pos + i)),
+			_mm_loadu_si128((const __m128i *)(m->step + i)));
+		_mm_storeu_si128((__m128i *)(m->pos + i), pos);
+		col = _mm_srai_epi32(pos, FIX_SHIFT);
+		flags = _mm_andnot_si128(_mm_cmpeq_epi32(col, _mm_loadu_si128((const __m128i *)(m->col + i))), due);
+		flags = _mm_or_si128(flags, _mm_and_si128(dead, _mm_or_si128(_mm_cmpgt_epi32(col, maxCol),
+			_mm_cmplt_epi32(col, _mm_loadu_si128((const __m128i *)(m->minCol + i))))));
+		_mm_storeu_si128((__m128i *)(m->col + i), col);
+		flags = _mm_packs_epi32(flags, flags);	/* four ints down to four bytes */
+		packed = _mm_cvtsi128_si32(_mm_packus_epi16(flags, flags));
+		memcpy(m->flags + i, &packed, 4);
+	}
+	scalarStep(m, i, first + count - i);
+}
+
+/******************************* AVX2 *******************************/
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static void avx2Step(LogMotion *m, int first, int count)
+{
+	__m256i maxCol = _mm256_set1_epi32(m->maxCol);
+	__m256i due = _mm256_set1_epi32(MOTION_DUE);
+	__m256i dead = _mm256_set1_epi32(MOTION_DEAD);
+	__m256i pos, col, flags, off;
+	__m128i half;
+	int i;
+
+	for (i = first; i + 8 <= first + count; i += 8)
+	{
+		pos = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(m->pos + i)),
+			_mm256_loadu_si256((const __m256i *)(m->step + i)));
+		_mm256_storeu_si256((__m256i *)(m->pos + i), pos);
+		col = _mm256_srai_epi32(pos, FIX_SHIFT);
+		flags = _mm256_andnot_si256(_mm256_cmpeq_epi32(col, _mm256_loadu_si256((const __m256i *)(m->col + i))), due);
+		off = _mm256_or_si256(_mm256_cmpgt_epi32(col, maxCol),
+			_mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(m->minCol + i)), col));
+		flags = _mm256_or_si256(flags, _mm256_and_si256(dead, off));
+		_mm256_storeu_si256((__m256i *)(m->col + i), col);
+		/* the packs work within 128 bit halves, so pack the halves together */
+		half = _mm_packs_epi32(_mm256_castsi256_si128(flags), _mm256_extracti128_si256(flags, 1));
+		_mm_storel_epi64((__m128i *)(m->flags + i), _mm_packus_epi16(half, half));
+	}
+	sse2Step(m, i, first + count - i);
+}
+
+#endif /* MOTION_X86 */
+
+/********************** Interface functions ***********************/
+
+bool logMotionInit(LogMotion *motion, int slots, int maxCol)
+{
+	motion->pos = calloc(slots, sizeof(int));
+	motion->step = calloc(slots, sizeof(int));
+	motion->col = calloc(slots, sizeof(int));
+	motion->minCol = calloc(slots, sizeof(int));
+	motion->flags = calloc(slots, 1);
+	motion->maxCol = maxCol;
+	return (motion->pos != NULL && motion->step != NULL && motion->col != NULL &&
+		motion->minCol != NULL && motion->flags != NULL);
+}
+
+void logMotionFree(LogMotion *motion)
+{
+	free(motion->pos);
+	free(motion->step);
+	free(motion->col);
+	free(motion->minCol);
+	free(motion->flags);
+	memset(motion, 0, sizeof(LogMotion));
+}
+
+void logMotionStep(LogMotion *motion, int first, int count)
+{
+	switch (blitKernelInUse())
+	{
+#ifdef MOTION_X86
+	case BLIT_AVX2:
+		avx2Step(motion, first, count);
+		break;
+	case BLIT_SSE2:
+		sse2Step(motion, first, count);
+		break;
+#endif
+	default:
+		scalarStep(motion, first, count);
+		break;
+	}
+}
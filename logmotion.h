@@ -0,0 +1,43 @@
+/**********************************************************************
+  Module: logmotion.h
+
+  Purpose: The per tick motion of a lane's logs, kept as a structure of
+	   arrays and stepped by one kernel in SSE2 and AVX2 with a
+	   scalar fallback.
+
+  NOTES: lanes.c keeps one of these per lane, slot for slot with its
+	 ring of logs. Only the fields every log needs every tick live
+	 here; the Log itself keeps what is needed to draw it and carry
+	 the frog, and is only touched when the log reaches a new column.
+	 The kernel follows blitKernelInUse, so blitSelect picks it too.
+**********************************************************************/
+
+#ifndef LOGMOTION_H
+#define LOGMOTION_H
+
+#include <stdbool.h>
+
+#define MOTION_DUE 1	/* reached a new column this tick */
+#define MOTION_DEAD 2	/* off the board, the checkIsDead condition */
+
+typedef struct LOG_MOTION LogMotion;
+struct LOG_MOTION {
+	int *pos;		/* column, fixed point */
+	int *step;		/* velocity with the direction's sign, fixed point */
+	int *col;		/* column pos is in */
+	int *minCol;		/* a log left of this is off the board */
+	unsigned char *flags;	/* MOTION_DUE and MOTION_DEAD, for the last tick */
+	int maxCol;		/* a log right of this is off the board */
+};
+
+/* Allocates `slots' slots of every array. Returns false if it can't */
+extern bool logMotionInit(LogMotion *motion, int slots, int maxCol);
+
+/* Frees the arrays */
+extern void logMotionFree(LogMotion *motion);
+
+/* Moves the `count' logs from slot `first' on by one tick: adds step to pos,
+   works out the column and sets the flags of each */
+extern void logMotionStep(LogMotion *motion, int first, int count);
+
+#endif /* LOGMOTION_H */
@@ -0,0 +1,169 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file reads the command line options, picks the console backend (curses, -headless, or -ansi for slow links)
+ * and the journal, and starts the game, or with -server starts many games on their own terminals. -save and -restore
+ * pick a game up again from a snapshot.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "console.h"
+#include "frogger.h"
+#include "gameglobals.h"
+#include "replay.h"
+#include "input.h"
+#include "events.h"
+#include "session.h"
+#include "server.h"
+#include "threadwrappers.h"
+#include "cast.h"
+#include "snapshot.h"
+#include "trace.h"
+
+//-------------------------------------------------------------------//
+int main(int argc, char**argv) {
+  bool headless = false;
+  bool ansi = false;
+  bool matched = true;
+  char *dumpPath = NULL;
+  char *recordPath = NULL;
+  char *replayPath = NULL;
+  char *castPath = NULL;
+  char *savePath = NULL;
+  char *restorePath = NULL;
+  unsigned long runTicks = 0; //0 runs until the player quits or the game ends
+  unsigned int gameSeed = time(NULL);
+  int cols = DEFAULT_COLS;
+  int lanes = DEFAULT_LANES;
+  int serverSessions = 0;
+  int serverWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+  Session *local = newSession(0, -1);
+  int i;
+
+  setCurrentSession(local);
+  initLockStats();
+  initTrace();
+
+  for(i = 1; i < argc; i++){
+     if(strcmp(argv[i], "-headless") == 0){
+        headless = true;
+     }
+     else if(strcmp(argv[i], "-ansi") == 0){
+        ansi = true;
+     }
+     else if(strcmp(argv[i], "-dump") == 0 && i+1 < argc){
+        dumpPath = argv[++i];
+     }
+     else if(strcmp(argv[i], "-ticks") == 0 && i+1 < argc){
+        runTicks = strtoul(argv[++i], NULL, 10);
+     }
+     else if(strcmp(argv[i], "-seed") == 0 && i+1 < argc){
+        gameSeed = strtoul(argv[++i], NULL, 10);
+     }
+     else if(strcmp(argv[i], "-record") == 0 && i+1 < argc){
+        recordPath = argv[++i];
+     }
+     else if(strcmp(argv[i], "-replay") == 0 && i+1 < argc){
+        replayPath = argv[++i];
+     }
+     else if(strcmp(argv[i], "-cast") == 0 && i+1 < argc){
+        castPath = argv[++i];
+     }
+     else if(strcmp(argv[i], "-save") == 0 && i+1 < argc){
+        savePath = argv[++i];
+     }
+     else if(strcmp(argv[i], "-restore") == 0 && i+1 < argc){
+        restorePath = argv[++i];
+     }
+     else if(strcmp(argv[i], "-speed") == 0 && i+1 < argc){
+        setTickSpeedup(atoi(argv[++i]));
+     }
+     else if(strcmp(argv[i], "-w") == 0 && i+1 < argc){
+        cols = atoi(argv[++i]);
+     }
+     else if(strcmp(argv[i], "-l") == 0 && i+1 < argc){
+        lanes = atoi(argv[++i]);
+     }
+     else if(strcmp(argv[i], "-server") == 0 && i+1 < argc){
+        serverSessions = atoi(argv[++i]);
+     }
+     else if(strcmp(argv[i], "-workers") == 0 && i+1 < argc){
+        serverWorkers = atoi(argv[++i]);
+     }
+     else if(strcmp(argv[i], "-allkeys") == 0){
+        setInputPolicy(keepAllKeys);
+     }
+     else{
+        fprintf(stderr, "usage: %s [-headless | -ansi] [-dump file] [-ticks n] [-seed n] [-w cols] [-l lanes] [-allkeys] [-cast file] [-save file] [-restore file] [-record file | -replay file [-speed n] | -server sessions [-workers n]]\n", argv[0]);
+        exit(1);
+     }
+  }
+  if(headless){
+     consoleSelectBackend(HEADLESS_CONSOLE, dumpPath);
+  }
+  else if(ansi){
+     consoleSelectBackend(PTY_CONSOLE, NULL);
+  }
+  if(replayPath != NULL && !startReplay(replayPath, &gameSeed, &cols, &lanes)){
+     fprintf(stderr, "Can't replay %s\n", replayPath);
+     exit(1);
+  }
+  if(restorePath != NULL && (replayPath != NULL || recordPath != NULL || serverSessions > 0)){
+     fprintf(stderr, "A restored game can't be journaled or served\n"); //its journal would have no start
+     exit(1);
+  }
+  if(restorePath != NULL && !loadSnapshot(restorePath, &cols, &lanes)){
+     fprintf(stderr, "Can't restore %s\n", restorePath);
+     exit(1);
+  }
+  if(!setBoardSize(cols, lanes)){
+     fprintf(stderr, "The board needs %d to %d columns and 1 to %d lanes\n", MIN_COLS, MAX_COLS, MAX_LANES);
+     exit(1);
+  }
+  if(serverSessions > 0){
+     if(serverWorkers < 1){
+        serverWorkers = 1;
+     }
+     matched = runServer(serverSessions, serverWorkers, gameSeed);
+     freeSession(local);
+     return matched ? 0 : 1;
+  }
+  if(recordPath != NULL && !startRecording(recordPath, gameSeed, cols, lanes)){
+     fprintf(stderr, "Can't record to %s\n", recordPath);
+     exit(1);
+  }
+
+  if(castPath != NULL && !castStart(castPath)){
+     fprintf(stderr, "Can't record a cast to %s\n", castPath);
+     exit(1);
+  }
+
+  if(savePath != NULL){
+     saveOnExit(savePath);
+  }
+
+  startGame(gameSeed, runTicks);
+  castStop();
+  if(restorePath != NULL && snapshotLoaded()){
+     fprintf(stderr, "Can't restore %s on this board\n", restorePath);
+     exit(1);
+  }
+  if(restorePath != NULL){
+     fprintf(stderr, "restored tick %lu in %ld us\n", snapshotTick(), snapshotRestoreMicros());
+  }
+  matched = stopJournal(getTick());
+  printf("done!\n");
+  if(headless){
+     printf("frames: %ld cells: %ld\n", consoleFramesPublished(), consoleCellsWritten());
+     printf("deaths: %lu pods: %lu logs retired: %lu\n", eventCount(frogDied), eventCount(podReached), eventCount(logRetired));
+  }
+  freeSession(local);
+  return matched ? 0 : 1;
+}
@@ -11,7 +11,6 @@
 #include <string.h>
 #include <pthread.h>
 #include <unistd.h>
-#include <sys/select.h> //for keyboard functinonality
 #include <stdlib.h>
 
 #include "player.h"
@@ -19,119 +18,107 @@
 #include "console.h"
 #include "gameglobals.h"
 #include "log.h"
-#include "llist.h"
+#include "lanes.h"
+#include "bitboard.h"
 #include "frogger.h"
+#include "events.h"
+#include "session.h"
+#include "timerwheel.h"
+#include "trace.h"
 
-#define PLAYER_ANIM_TILES 2
-#define PLAYER_HEIGHT 2
-#define F_START_ROW 21
-#define F_START_COL 40
+#define VIEW_MARGIN_ROWS 6 //the view scrolls when the frog gets this close to its edge
+#define VIEW_MARGIN_COLS 10
 #define VERTICAL_JUMP 4
 #define SIDE_JUMP 1
 #define HOME_JUMP 3
+#define LEAVE_TICKS 10 //the frog stays where it died or in the pod this long before it goes back
+#define HOME_TICKS (RESPAWN_TICKS - LEAVE_TICKS) //then is gone this long before it shows up on the start bank
 
-static char* PLAYER_GRAPHIC[PLAYER_ANIM_TILES][PLAYER_HEIGHT+1] = {
-  {"@@",
-   "<>"},
-  {"--",
-   "<>"}
+/* Everything about the player in one session */
+typedef struct PLAYER_STATE PlayerState;
+struct PLAYER_STATE {
+   Frog frog;
+   int ticksToBlink;
+   Log *carrier; //log that had the frog last time
+   Bitboard openPods; //columns the frog can jump into an empty pod from
+   TimerHandle leave, back; //pending while the frog is on its way back to the start bank
 };
-static const int SAFE_POD_1 = 0;
-static const int SAFE_POD_2 = 18;
-static const int SAFE_POD_3 = 36;
-static const int SAFE_POD_4 = 54;
-static const int SAFE_POD_5 = 72;
-
-Frog *frog; //global frog
 
 //---PROTOTYPES---------------------------------------------------------
 static void updatePrevious();
+static PlayerState *state();
 static void drawFrog();
+static int startRow();
+static int recenter(int view, int viewSize, int pos, int size, int margin);
+static bool carries(Log *log, Frog *frog);
+static Log *findCarrier(Lane *lane, Frog *frog);
+static void markPod(int pod, bool open);
+static bool respawning();
+static void leaveSpot(void *arg);
+static void returnHome(void *arg);
 //---METHODS------------------------------------------------------------//
 
 void initializePlayer(){
-   frog = (Frog *)malloc(sizeof(Frog));
    createFrog();
-   createThread(&tids[getThreadCount()], animateFrog, NULL);
-   createThread(&tids[getThreadCount()], initMovement, NULL);
+   followFrog();
 } 
 
-void *animateFrog(){
-   while(!isGameOver()){
-      lockMutex(&playerLock);
-      if(frog->animateState == first)
-         frog->animateState = second;
-      else
-         frog->animateState = first;
-      unlockMutex(&playerLock);
-      drawFrog();
-      sleepTicks(frog->blinkSpeed); 
+void animateFrog(){
+   Frog *frog = getFrog();
+   if(--state()->ticksToBlink > 0 || respawning()){
+      return;
    }
-   pthread_exit(NULL);
+   lockMutex(playerLock());
+   if(frog->animateState == first)
+      frog->animateState = second;
+   else
+      frog->animateState = first;
+   unlockMutex(playerLock());
+   drawFrog();
+   state()->ticksToBlink = frog->blinkSpeed;
 }
 
-void *initMovement(){
-   fd_set set;
-
-   while(!isGameOver()){
-      FD_ZERO(&set);
-      FD_SET(STDIN_FILENO, &set);
-      struct timespec timeout = getTimeout(1); /* duration of one tick */
-      int ret = pselect(FD_SETSIZE, &set, NULL, NULL, &timeout, NULL);
- 
-      if(ret == -1){
-         exit(1);
-      }
-      else if(ret == 0){
-         continue; //pselect timed out, no chars were entered
-      }
-      else{
-         char c = getchar();
-         if(c == QUIT){
-	    endGame("quitters never prosper");
-	 }
-	 else{
-	    moveFrog(c);
-	 }
-      }
+void applyKey(int c){
+   if(c == QUIT){
+      endGame("quitters never prosper");
+   }
+   else if(!respawning()){ //only quitting works until the frog is back
+      moveFrog(c);
    }
-   pthread_exit(NULL);
 }
 
 void moveFrog(char c){
+   Frog *frog = getFrog();
    if(c == LEFT_KEY && frog->currPos[1] > LEFT_EDGE){
-      lockMutex(&playerLock);
+      lockMutex(playerLock());
       updatePrevious();
       frog->currPos[1] -= SIDE_JUMP;
-      unlockMutex(&playerLock);
+      unlockMutex(playerLock());
 
-   }else if(c == RIGHT_KEY && frog->currPos[1] < RIGHT_EDGE-frog->width){ //screen size - width of frog
-      lockMutex(&playerLock);
+   }else if(c == RIGHT_KEY && frog->currPos[1] < boardCols()-frog->width){ //board width - width of frog
+      lockMutex(playerLock());
       updatePrevious();
       frog->currPos[1] += SIDE_JUMP;
-      unlockMutex(&playerLock);
+      unlockMutex(playerLock());
 
    }else if(c == UP_KEY && homeFree()){ //safe!!
-      lockMutex(&playerLock);
+      lockMutex(playerLock());
       updatePrevious();
       frog->currPos[0] -= HOME_JUMP;
-      unlockMutex(&playerLock);
-      drawFrog();
-      sleepTicks(10);
-      moveHome();
-      checkWin();
+      unlockMutex(playerLock());
+      state()->leave = scheduleTimer(LEAVE_TICKS, leaveSpot, NULL);
 
-   }else if(c == DOWN_KEY && frog->currPos[0] < F_START_ROW-frog->height){
-      lockMutex(&playerLock);
+   }else if(c == DOWN_KEY && frog->currPos[0] < startRow()-frog->height){
+      lockMutex(playerLock());
       updatePrevious();
       frog->currPos[0] += VERTICAL_JUMP;
-      unlockMutex(&playerLock);
+      unlockMutex(playerLock());
       
-   }else if(c == UP_KEY && frog->currPos[0] > 8){
-      lockMutex(&playerLock);
+   }else if(c == UP_KEY && frog->currPos[0] > laneRow(1)){
+      lockMutex(playerLock());
       updatePrevious();
       frog->currPos[0] -= VERTICAL_JUMP;
-      unlockMutex(&playerLock);
+      unlockMutex(playerLock());
    }
    
    drawFrog();
@@ -140,135 +127,287 @@ void moveFrog(char c){
 }
 
 void moveHome(){
-   char **tile = PLAYER_GRAPHIC[frog->animateState];
+   Frog *frog = getFrog();
    setHomePosition();
-   lockMutex(&screenLock);
-   sleepTicks(50);
-   consoleDrawImage(frog->currPos[0], frog->currPos[1], tile, frog->height);
-   unlockMutex(&screenLock);
+   consoleDrawImage(frog->currPos[0], frog->currPos[1], &frogSprite, frog->animateState);
    drawFrog();
 }
 
 bool homeFree(){
-   int podLocations[] = {SAFE_POD_1, SAFE_POD_2, SAFE_POD_3, SAFE_POD_4, SAFE_POD_5};
+   Frog *frog = getFrog();
    bool home = false;
+   int col = frog->currPos[1];
    int i;
-   int podCount = 0;
-   for(i = 0; i < NUM_PODS && !home; i++){
-      if(frog->currPos[0] == 5 && frog->currPos[1] > podLocations[i] && frog->currPos[1] < podLocations[i] + POD_WIDTH - frog->width && 
-        !frog->podFull[podCount]){
-         home = true;
-	 frog->podFull[i] = true;
+   if(frog->currPos[0] == SAFE_BANK+1 && bitboardTest(&state()->openPods, col)){
+      for(i = 0; i < NUM_PODS && !home; i++){
+         if(col > podCol(i) && col < podCol(i) + POD_WIDTH){
+            home = true;
+            frog->podFull[i] = true;
+            markPod(i, false);
+            publishEvent(podReached, i);
+         }
       }
    }
    return home;
 }
 
 void isFrogOnAnyLog(){
+   Frog *frog = getFrog();
+   Lane *lane = NULL;
+   Log *prevLog = NULL;
    Log *currLog = NULL;
-   bool onLog = false;
+   int row, col;
 
-   lockMutex(&listLock);
-   lockMutex(&playerLock);
-   while(!isGameOver() && currLog == NULL){
-      currLog = firstItem();
-   }
-   while(!isGameOver() && currLog != NULL){
-      if((frog->currPos[0] > currLog->startRow) && ((frog->currPos[0]+frog->height) < currLog->startRow+currLog->height) &&
-       ((frog->currPos[1]+frog->width) < (currLog->currCol+currLog->width)) && (frog->currPos[1] > currLog->currCol)){
-	 currLog->hasFrog = true;
-	 frog->onLog = true;
-	 onLog = true;
-      }
-      else{
-         currLog->hasFrog = false;
+   traceBegin("isFrogOnAnyLog");
+   lockMutex(playerLock());
+   row = frog->currPos[0];
+   col = frog->currPos[1];
+   lane = laneForRow(row);
+   prevLog = state()->carrier;
+   unlockMutex(playerLock());
+
+   //the lane's bitboard says if any log is under the frog, only then is the log itself looked up
+   if(lane != NULL && row > lane->row && row + frog->height < lane->row + LOG_HEIGHT){
+      lockMutex(&lane->lock);
+      if(!isGameOver() && laneCarries(lane, col, col + frog->width - 1)){
+         if(prevLog != NULL && prevLog->lane == lane && carries(prevLog, frog))
+            currLog = prevLog; //still riding the same log, the usual case
+         else
+            currLog = findCarrier(lane, frog);
       }
-      currLog = nextAvailableLog();
+      unlockMutex(&lane->lock);
+   }
+
+   //a log that went back to the pool may have been reused, but only the log under
+   //the frog can have the frog so clearing the flag is always safe
+   if(prevLog != NULL && prevLog != currLog){
+      prevLog->hasFrog = false;
    }
-   unlockMutex(&playerLock);
-   unlockMutex(&listLock);
+   lockMutex(playerLock());
+   if(currLog != NULL){
+      currLog->hasFrog = true;
+   }
+   frog->onLog = currLog != NULL;
+   state()->carrier = currLog;
+   unlockMutex(playerLock());
+   traceEnd();
+}
 
-   lockMutex(&playerLock);
-   if(!onLog){
-      frog->onLog = false;
+void followFrog(){
+   Frog *frog = getFrog();
+   int top, left, height, width;
+   consoleViewport(&top, &left, &height, &width);
+   top = recenter(top, height, frog->currPos[0], frog->height, VIEW_MARGIN_ROWS);
+   left = recenter(left, width, frog->currPos[1], frog->width, VIEW_MARGIN_COLS);
+   if(consoleSetViewport(top, left)){ //only the board is left in view, put everything back on it
+      drawVisibleLogs();
+      drawFrog();
    }
-   unlockMutex(&playerLock);
+}
+
+/* Puts the frog back in the middle of the view once it gets within `margin'
+   of either edge, so the view jumps now and then instead of every move */
+static int recenter(int view, int viewSize, int pos, int size, int margin){
+   if(pos < view + margin || pos + size > view + viewSize - margin){
+      view = pos + size/2 - viewSize/2;
+   }
+   return view;
 }
 
 static void drawFrog(){
-   char **tile = PLAYER_GRAPHIC[frog->animateState];
-   lockMutex(&screenLock);
-   lockMutex(&playerLock);
+   Frog *frog = getFrog();
+   traceBegin("drawFrog");
+   consoleBeginUpdate();
+   lockMutex(playerLock());
    consoleClearImage(frog->prevPos[0], frog->prevPos[1], frog->height, frog->width);
-   consoleDrawImage(frog->currPos[0], frog->currPos[1], tile, frog->height);
-   unlockMutex(&playerLock);
-   unlockMutex(&screenLock);
+   consoleDrawImage(frog->currPos[0], frog->currPos[1], &frogSprite, frog->animateState);
+   unlockMutex(playerLock());
+   consoleEndUpdate();
+   traceEnd();
 }
 
 void setHomePosition(){
-   frog->prevPos[0] = frog->currPos[0] = F_START_ROW;
-   frog->prevPos[1] = frog->currPos[1] = F_START_COL;
+   Frog *frog = getFrog();
+   frog->prevPos[0] = frog->currPos[0] = startRow();
+   frog->prevPos[1] = frog->currPos[1] = boardCols()/2;
 }
 
 void checkWin(){
+   if(podsFilled()){
+      endGame("you're a champ");
+   }
+}
+
+bool podsFilled(){
+   Frog *frog = getFrog();
    int winCount = 0;
    int i;
    for(i = 0; i < NUM_PODS; i++){
       if(frog->podFull[i])
          winCount++;
    }
-   if(winCount == NUM_PODS){ //all spaces are filled
-      endGame("you're a champ");
-   }
+   return winCount == NUM_PODS; //all spaces are filled
 }
 
 void checkDead(){
+   Frog *frog = getFrog();
    if(!inSafeZone()){
-      lockMutex(&playerLock);
+      lockMutex(playerLock());
       frog->dead = true;
-      unlockMutex(&playerLock);
-   }
-
-   if(frog->dead){
-      sleepTicks(10);
-      moveHome();
-      lockMutex(&playerLock);
-      frog->dead = false;
-      unlockMutex(&playerLock);
+      unlockMutex(playerLock());
+      publishEvent(frogDied, 0);
+      state()->leave = scheduleTimer(LEAVE_TICKS, leaveSpot, NULL);
    }
 }
 
 bool inSafeZone(){
+   Frog *frog = getFrog();
    bool safe = false;
-   if(frog->onLog || frog->currPos[0] > START_BANK || frog->currPos[0] < SAFE_BANK){
+   if(frog->onLog || frog->currPos[0] > startBank() || frog->currPos[0] < SAFE_BANK){
       safe = true;
    }
    return safe;
 }
 
 void createFrog(){
-   char **tile = PLAYER_GRAPHIC[0];
+   Frog *frog;
+   if(state() == NULL){
+      currentSession()->player = (PlayerState *)calloc(1, sizeof(PlayerState));
+      if(state() == NULL){
+         printError();
+      }
+   }
+   frog = getFrog();
    setHomePosition();
 
-   lockMutex(&playerLock);
+   lockMutex(playerLock());
    frog->blinkSpeed = 30;
    frog->animateState = first;
-   frog->height = PLAYER_HEIGHT;
-   frog->width = strlen(tile[0]);
+   frog->height = frogSprite.height;
+   frog->width = frogSprite.width;
    frog->dead = false;
    frog->onLog = false;
    int i;
+   bitboardFree(&state()->openPods);
+   if(!bitboardInit(&state()->openPods, boardCols())){
+      printError();
+   }
    for(i = 0; i < NUM_PODS; i++){
       frog->podFull[i] = false;
+      markPod(i, true);
+   }
+   state()->ticksToBlink = 0;
+   state()->carrier = NULL;
+   unlockMutex(playerLock());
+}
+
+void deletePlayer(){
+   if(state() != NULL){
+      bitboardFree(&state()->openPods);
+   }
+   free(state());
+   currentSession()->player = NULL;
+}
+
+int blinkTicks(){
+   return state()->ticksToBlink;
+}
+
+int respawnTicks(){
+   if(timerPending(state()->leave)){
+      return timerRemaining(state()->leave) + HOME_TICKS;
+   }
+   return timerRemaining(state()->back);
+}
+
+void restorePlayer(const Frog *saved, int ticksToBlink, int ticksToRespawn, Log *carrier){
+   Frog *frog = getFrog();
+   int i;
+   lockMutex(playerLock());
+   consoleClearImage(frog->currPos[0], frog->currPos[1], frog->height, frog->width); //the new frog on the start bank
+   *frog = *saved;
+   state()->ticksToBlink = ticksToBlink;
+   state()->carrier = carrier;
+   unlockMutex(playerLock());
+   if(ticksToRespawn > HOME_TICKS){
+      state()->leave = scheduleTimer(ticksToRespawn - HOME_TICKS, leaveSpot, NULL);
+   }
+   else if(ticksToRespawn > 0){
+      state()->back = scheduleTimer(ticksToRespawn, returnHome, NULL);
+   }
+   for(i = 0; i < NUM_PODS; i++){
+      markPod(i, !frog->podFull[i]);
+      if(frog->podFull[i]){ //where it jumped in isn't saved, the middle of the pod will do
+         consoleDrawImage(SAFE_BANK+1-HOME_JUMP, podCol(i)+1, &frogSprite, first);
+      }
+   }
+   //drawn without drawFrog, clearing the saved previous spot would cut into the logs
+   followFrog();
+   drawVisibleLogs();
+   if(!timerPending(state()->back)){ //already gone from where it was, not back yet
+      consoleDrawImage(frog->currPos[0], frog->currPos[1], &frogSprite, frog->animateState);
    }
-   unlockMutex(&playerLock);
 }
 
 Frog *getFrog(){
-   return frog;
+   return &state()->frog;
+}
+
+static PlayerState *state(){
+   return currentSession()->player;
+}
+
+/* The frog starts on the row under the start bank */
+static int startRow(){
+   return startBank()+1;
 }
 
 static void updatePrevious(){
+   Frog *frog = getFrog();
    frog->prevPos[0] = frog->currPos[0];
    frog->prevPos[1] = frog->currPos[1];
 }
+
+/* The frog sits inside the log, off both of its edge columns and between its top and bottom rows */
+static bool carries(Log *log, Frog *frog){
+   return frog->currPos[0] > log->startRow && frog->currPos[0] + frog->height < log->startRow + log->height &&
+      frog->currPos[1] > log->currCol && frog->currPos[1] + frog->width < log->currCol + log->width;
+}
+
+/* The log under the frog, when the frog just landed on it. Caller holds the lane lock */
+static Log *findCarrier(Lane *lane, Frog *frog){
+   LaneIter iter;
+   Log *log;
+   laneIterRange(&iter, lane, frog->currPos[1], frog->currPos[1] + frog->width - 1);
+   while((log = laneIterNext(&iter)) != NULL && !carries(log, frog));
+   return log;
+}
+
+/* Opens or fills the pod's columns in the pod bitboard */
+static void markPod(int pod, bool open){
+   bitboardSetRange(&state()->openPods, podCol(pod)+1, podCol(pod)+POD_WIDTH-getFrog()->width-1, open);
+}
+
+/* The frog is dead or in a pod and not back on the start bank yet */
+static bool respawning(){
+   return timerPending(state()->leave) || timerPending(state()->back);
+}
+
+/* The frog leaves where it died or the pod it filled, and shows up on the start bank a while later */
+static void leaveSpot(void *arg){
+   lockMutex(playerLock());
+   setHomePosition();
+   unlockMutex(playerLock());
+   state()->back = scheduleTimer(HOME_TICKS, returnHome, NULL);
+}
+
+/* The frog is back on the start bank and can move again. If it got there from the
+   last pod, the game is won */
+static void returnHome(void *arg){
+   Frog *frog = getFrog();
+   moveHome();
+   lockMutex(playerLock());
+   frog->dead = false;
+   unlockMutex(playerLock());
+   checkWin();
+}
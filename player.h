@@ -7,6 +7,8 @@
 #include "log.h"
 #include "gameglobals.h"
 
+#define RESPAWN_TICKS 60 //from dying or filling a pod until the frog is back on the start bank
+
 typedef struct FROG Frog;
 
 struct FROG {
@@ -21,33 +23,40 @@ bool dead;
 bool podFull[5];
 };
 
-/* Creates threads required for movement and animation of the player */ 
+/* Creates the frog and points the view at it */ 
 void initializePlayer();
 
-/* Keeps track of current animation state, draws the frog and set blink speed */
-void *animateFrog();
+/* Called by the game loop once per tick. Flips the animation state and draws
+   the frog every `blinkSpeed' ticks */
+void animateFrog();
+
+/* Called by the game loop once per tick. Scrolls the view when the frog gets
+   near its edge and redraws what's in view */
+void followFrog();
 
-/* Uses pselect to either timeout if no chars are entered or gets the character */ 
-void *initMovement();
+/* Applies one key press: quits or moves the frog. Moves are dropped while the
+   frog is on its way back to the start bank */
+void applyKey(int c);
 
 /* Depending on which character was entered, move the frog in 1 of 4 directions.
    If the frog is in the last row and jumps to a safe spot, save the graphic and 
-   move the frog back to the beginning. Also checks for frog death and if the frog
+   send the frog back to the beginning. Also checks for frog death and if the frog
    is on any logs. */
 void moveFrog(char direction);
 
-/* Sets up the frog's attributes */ 
+/* Allocates the session's frog if needed and sets up its attributes */ 
 void createFrog();
 
-/* Goes through the linked list to see if the frog is on any one of the logs on
-   screen. This helps the moveFrogWithLog method in the log.c */
+/* Checks the lane's bitboard to see if the frog is on a log and marks that log
+   as having the frog, so logController takes the frog along with it */
 void isFrogOnAnyLog();
 
-/* Compares frog position with the safe pod positions to see if the frog has jumped
-   to safety. If so, it sets the spot to true in the frog's podFull array.*/
+/* Checks the frog position against the bitboard of empty pods to see if the frog
+   has jumped to safety. If so, it sets the spot to true in the frog's podFull
+   array, closes the pod and publishes the pod reached event.*/
 bool homeFree();
 
-/* Draws the frog back at the start bank */
+/* Puts the frog back at the start bank and draws it */
 void moveHome();
 
 /* Sets the frog's home coordinates */
@@ -56,14 +65,34 @@ void setHomePosition();
 /*Checks to make sure frog is on a log or on the home bank */ 
 bool inSafeZone();
 
-/* Checks to see if the frog is in a safe zone, and moves to the home
-   if frog is dead */ 
+/* Checks to see if the frog is in a safe zone, and publishes the frog died
+   event and sends the frog back to the home if frog is dead. The frog comes
+   back RESPAWN_TICKS later, the game carries on meanwhile */ 
 void checkDead();
 
 /* Checks to see if the frog has made it to all the safe pods */
 void checkWin();
 
-/* Returns the global frog */
+/* Returns true if the frog has made it to all the safe pods */
+bool podsFilled();
+
+/* Returns how many ticks are left until the frog blinks again */
+int blinkTicks();
+
+/* Returns how many ticks are left until the frog is back on the start bank, 0
+   if it isn't on its way */
+int respawnTicks();
+
+/* Puts a saved frog back into a freshly opened game: its position, pods,
+   blink and respawn, and `carrier' as the log it is riding (NULL if none).
+   The view follows it and the filled pods, the logs in view and the frog are
+   drawn */
+void restorePlayer(const Frog *saved, int ticksToBlink, int ticksToRespawn, Log *carrier);
+
+/* Returns the current session's frog */
 Frog *getFrog();
 
+/* Frees the current session's frog at the end of the game */
+void deletePlayer();
+
 #endif
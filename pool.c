@@ -0,0 +1,72 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file is a fixed capacity object pool. All the items live in one slab that is allocated up front, and free slots are
+ * kept on a singly linked free list stored inside the slots themselves, so allocating and freeing never touch malloc.
+ * None of these methods lock, the caller has to hold whatever lock protects the pool.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "pool.h"
+
+typedef union SLOT Slot;
+union SLOT {
+   Slot *next;
+   long double align; //keeps every slot aligned for any type
+};
+
+bool poolInit(Pool *pool, int itemSize, int capacity){
+   bool success = false;
+   int i;
+
+   //round the slot up so the free list pointer and alignment both fit
+   if(itemSize < sizeof(Slot)){
+      itemSize = sizeof(Slot);
+   }
+   itemSize = (itemSize + sizeof(Slot) - 1) / sizeof(Slot) * sizeof(Slot);
+
+   pool->slab = (char *)malloc((size_t)itemSize * capacity);
+   pool->freeList = NULL;
+   pool->itemSize = itemSize;
+   pool->capacity = 0;
+   pool->inUse = 0;
+   if(pool->slab != NULL){
+      for(i = capacity-1; i >= 0; i--){
+         Slot *slot = (Slot *)(pool->slab + (size_t)i*itemSize);
+         slot->next = (Slot *)pool->freeList;
+         pool->freeList = slot;
+      }
+      pool->capacity = capacity;
+      success = true;
+   }
+   return success;
+}
+
+void *poolAlloc(Pool *pool){
+   Slot *slot = (Slot *)pool->freeList;
+   if(slot != NULL){
+      pool->freeList = slot->next;
+      pool->inUse++;
+   }
+   return slot;
+}
+
+void poolFree(Pool *pool, void *item){
+   Slot *slot = (Slot *)item;
+   if(slot != NULL){
+      slot->next = (Slot *)pool->freeList;
+      pool->freeList = slot;
+      pool->inUse--;
+   }
+}
+
+void poolDestroy(Pool *pool){
+   free(pool->slab);
+   pool->slab = NULL;
+   pool->freeList = NULL;
+   pool->capacity = 0;
+   pool->inUse = 0;
+}
@@ -0,0 +1,30 @@
+/* The header file for pool.c
+*/
+
+#ifndef POOL_H
+#define POOL_H
+#include <stdbool.h>
+
+typedef struct POOL Pool;
+struct POOL {
+   char *slab;
+   void *freeList;
+   int itemSize;
+   int capacity;
+   int inUse;
+};
+
+/* Allocates one slab with room for `capacity' items of `itemSize' bytes and
+   threads every slot onto the free list */
+bool poolInit(Pool *pool, int itemSize, int capacity);
+
+/* Takes a slot off the free list. Returns NULL when the pool is full */
+void *poolAlloc(Pool *pool);
+
+/* Puts a slot back on the free list so it can be recycled */
+void poolFree(Pool *pool, void *item);
+
+/* Frees the slab. Every item handed out by the pool is gone after this */
+void poolDestroy(Pool *pool);
+
+#endif
@@ -0,0 +1,353 @@
+/**********************************************************************
+  Module: ptyconsole.c
+
+  Purpose: ANSI backend for console.c, for server sessions played on a
+	   pseudo-terminal and for the local game with -ansi. see
+	   consolebackend.h
+
+  NOTES: curses can only drive the one terminal the process was started
+	 on, so this backend writes the escape sequences itself, and
+	 writes as few of them as it can since players are often on slow
+	 links. It keeps a copy of what the terminal shows; changed rows
+	 are collected while a frame is drawn and diffed against it when
+	 the frame is presented. Only the cells that differ go out, each
+	 run reached with the cheapest cursor motion (or by rewriting a
+	 short unchanged gap), and the whole frame is one writev inside a
+	 synchronized update so the terminal never shows half of it.
+	 The terminal is non-blocking: if nobody is reading it and it
+	 fills up, the rest of the frame is dropped instead of stalling
+	 the worker, and the next frame repaints everything.
+**********************************************************************/
+
+#include "consolebackend.h"
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/uio.h>
+
+#define OPEN_SCREEN "\033[?1049h\033[2J\033[?25l"	/* alternate screen, clear, hide the cursor */
+#define CLOSE_SCREEN "\033[?25h\033[0m\033[?1049l"	/* show the cursor, back to the normal screen */
+#define CLEAR_SCREEN "\033[2J\033[?25l"	/* clear, hide the cursor */
+#define RESET_SCREEN "\033[?25h\033[0m\r\n"	/* show the cursor again */
+#define BEGIN_UPDATE "\033[?2026h"	/* synchronized update, the terminal holds the frame until END_UPDATE */
+#define END_UPDATE "\033[?2026l"
+#define CANCEL "\030"	/* CAN, ends an escape sequence a dropped frame cut off */
+#define MOVE_LEN 16	/* longest cursor motion, "\033[rrrr;ccccH" */
+#define UNKNOWN -1	/* cursor row after writing the last column, where it may have wrapped */
+#define NO_CELL '\0'	/* never drawn, so a cell holding it always differs */
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+typedef struct PTY_SCREEN PtyScreen;
+struct PTY_SCREEN {
+	int fd;
+	int height, width;
+	char *want;		/* the frame being drawn */
+	char *shown;		/* what the terminal shows */
+	bool *changed;		/* rows drawn since the last present */
+	bool repaint;		/* the last frame was cut short, diff every row */
+	bool local;		/* the process' own terminal, put back on finish */
+	struct termios saved;
+
+	/* the frame being written: cursor motions go in moves, the iovecs
+	   point at them and at the runs of cells in shown */
+	struct iovec *iov;
+	int iovCount, iovSize;
+	char *moves;
+	int movesLen, movesSize;
+	int cursorRow, cursorCol;
+
+	long frames, bytes, maxBytes, dropped;
+};
+
+/* Local functions */
+
+static PtyScreen *screenState(void)
+{
+	return currentSession()->backendState;
+}
+
+static void writeAll(int fd, const char *bytes, int len)
+{
+	int written;
+
+	while (len > 0 && (written = write(fd, bytes, len)) > 0)	/* stops at a full terminal */
+	{
+		bytes += written;
+		len -= written;
+	}
+}
+
+static int digits(int n)
+{
+	int count = 1;
+
+	while (n >= 10)
+	{
+		n /= 10;
+		count++;
+	}
+	return (count);
+}
+
+/* Queues `len' bytes that stay put until the frame is written */
+static void addIov(PtyScreen *p, const char *bytes, int len)
+{
+	struct iovec *last = p->iovCount > 0 ? &p->iov[p->iovCount - 1] : NULL;
+
+	if (last != NULL && (char *)last->iov_base + last->iov_len == bytes)
+		last->iov_len += len;	/* carries on where the last one stopped */
+	else
+	{
+		p->iov[p->iovCount].iov_base = (void *)bytes;
+		p->iov[p->iovCount].iov_len = len;
+		p->iovCount++;
+	}
+}
+
+static void addMove(PtyScreen *p, const char *move, int len)
+{
+	memcpy(p->moves + p->movesLen, move, len);
+	addIov(p, p->moves + p->movesLen, len);
+	p->movesLen += len;
+}
+
+/* Cursor motion relative to where the cursor is, the row first */
+static int relativeMove(char *move, int fromRow, int fromCol, int row, int col)
+{
+	int len = 0;
+
+	if (row > fromRow)
+		len = snprintf(move, MOVE_LEN, row - fromRow == 1 ? "\033[B" : "\033[%dB", row - fromRow);
+	else if (row < fromRow)
+		len = snprintf(move, MOVE_LEN, fromRow - row == 1 ? "\033[A" : "\033[%dA", fromRow - row);
+	if (col == fromCol)
+		return (len);
+	if (col == 0)
+		move[len++] = '\r';
+	else if (col > fromCol)
+		len += snprintf(move + len, MOVE_LEN, col - fromCol == 1 ? "\033[C" : "\033[%dC", col - fromCol);
+	else if (digits(fromCol - col) <= digits(col + 1))
+		len += snprintf(move + len, MOVE_LEN, fromCol - col == 1 ? "\033[D" : "\033[%dD", fromCol - col);
+	else
+		len += snprintf(move + len, MOVE_LEN, "\033[%dG", col + 1);
+	return (len);
+}
+
+/* Puts the cursor on `row',`col' with the shortest sequence that gets it
+   there. Returns how many unchanged cells to rewrite instead of moving, when
+   that is shorter */
+static int moveCursor(PtyScreen *p, int row, int col)
+{
+	char move[MOVE_LEN], relative[2 * MOVE_LEN];
+	int len, relativeLen, gap;
+
+	if (p->cursorRow == row && p->cursorCol == col)
+		return (0);
+	gap = col - p->cursorCol;
+	if (p->cursorRow == row && gap > 0 && gap <= 3 + digits(gap))	/* no longer than "\033[nC" */
+		return (gap);
+	if (col == 0)
+		len = snprintf(move, MOVE_LEN, "\033[%dH", row + 1);
+	else
+		len = snprintf(move, MOVE_LEN, "\033[%d;%dH", row + 1, col + 1);
+	if (p->cursorRow != UNKNOWN)
+	{
+		relativeLen = relativeMove(relative, p->cursorRow, p->cursorCol, row, col);
+		if (relativeLen < len)
+		{
+			addMove(p, relative, relativeLen);
+			return (0);
+		}
+	}
+	addMove(p, move, len);
+	return (0);
+}
+
+/* Writes the cells of one row that differ from what the terminal shows */
+static void diffRow(PtyScreen *p, int row)
+{
+	char *want = p->want + (size_t)row * p->width;
+	char *shown = p->shown + (size_t)row * p->width;
+	int col = 0;
+	int start, gap;
+
+	while (col < p->width)
+	{
+		for (; col < p->width && want[col] == shown[col]; col++);
+		if (col == p->width)
+			break;
+		start = col;
+		for (; col < p->width && want[col] != shown[col]; col++);
+		memcpy(shown + start, want + start, col - start);
+		gap = moveCursor(p, row, start);
+		addIov(p, shown + start - gap, col - start + gap);
+		p->cursorRow = col == p->width ? UNKNOWN : row;	/* may have wrapped */
+		p->cursorCol = col;
+	}
+}
+
+static void writeFrame(PtyScreen *p)
+{
+	long written = 0;
+	ssize_t count, len;
+	int first, batch, i;
+
+	for (first = 0; first < p->iovCount; first += batch)
+	{
+		batch = p->iovCount - first < IOV_MAX ? p->iovCount - first : IOV_MAX;
+		for (len = 0, i = first; i < first + batch; i++)
+			len += p->iov[i].iov_len;
+		count = writev(p->fd, p->iov + first, batch);
+		if (count > 0)
+			written += count;
+		if (count != len)
+			break;
+	}
+	p->frames++;
+	p->bytes += written;
+	if (written > p->maxBytes)
+		p->maxBytes = written;
+	if (first < p->iovCount)
+	{
+		/* the terminal is full, whatever it got may end mid escape and it
+		   no longer shows what we think it does */
+		memset(p->shown, NO_CELL, (size_t)p->height * p->width);
+		p->repaint = true;
+		p->dropped++;
+	}
+}
+
+/* The process' own terminal, keys unbuffered and not echoed like curses' crmode */
+static void openLocal(PtyScreen *p)
+{
+	struct termios keys;
+
+	p->local = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &p->saved) == 0;
+	if (p->local)
+	{
+		keys = p->saved;
+		keys.c_lflag &= ~(ICANON | ECHO);
+		keys.c_cc[VMIN] = 1;
+		keys.c_cc[VTIME] = 0;
+		tcsetattr(STDIN_FILENO, TCSANOW, &keys);
+	}
+	writeAll(p->fd, OPEN_SCREEN, strlen(OPEN_SCREEN));
+}
+
+static bool ptyInit(int height, int width)
+{
+	PtyScreen *p = calloc(1, sizeof(PtyScreen));
+	int ttyFd = currentSession()->ttyFd;
+
+	if (p == NULL)
+		return (false);
+	currentSession()->backendState = p;
+	p->fd = ttyFd >= 0 ? ttyFd : STDOUT_FILENO;
+	p->height = height;
+	p->width = width;
+	p->want = malloc((size_t)height * width);
+	p->shown = malloc((size_t)height * width);
+	p->changed = calloc(height, sizeof(bool));
+	p->iovSize = height * (width + 1) + 3;	/* a move and a run for every other cell at worst, and the markers */
+	p->iov = malloc(p->iovSize * sizeof(struct iovec));
+	p->movesSize = height * (width / 2 + 1) * MOVE_LEN + 32;
+	p->moves = malloc(p->movesSize);
+	if (p->want == NULL || p->shown == NULL || p->changed == NULL || p->iov == NULL || p->moves == NULL)
+		return (false);
+	memset(p->shown, ' ', (size_t)height * width);	/* the screen is cleared below */
+	p->cursorRow = UNKNOWN;
+
+	if (ttyFd >= 0)
+		writeAll(p->fd, CLEAR_SCREEN, strlen(CLEAR_SCREEN));
+	else
+		openLocal(p);
+	return (true);
+}
+
+static void ptyDrawRow(int row, const char *cells, int width)
+{
+	PtyScreen *p = screenState();
+
+	memcpy(p->want + (size_t)row * p->width, cells, width < p->width ? width : p->width);
+	p->changed[row] = true;
+}
+
+static void ptyPresent(void)
+{
+	PtyScreen *p = screenState();
+	int row;
+
+	p->iovCount = 0;
+	p->movesLen = 0;
+	if (p->repaint)
+	{
+		addMove(p, CANCEL, strlen(CANCEL));
+		p->cursorRow = UNKNOWN;
+	}
+	addMove(p, BEGIN_UPDATE, strlen(BEGIN_UPDATE));
+	for (row = 0; row < p->height; row++)
+	{
+		if (p->changed[row] || p->repaint)
+			diffRow(p, row);
+		p->changed[row] = false;
+	}
+	p->repaint = false;
+	if (p->iovCount == 1)
+		return;	/* nothing differs, nothing to send */
+	addMove(p, END_UPDATE, strlen(END_UPDATE));
+	writeFrame(p);
+}
+
+static void ptyWaitForKey(void)
+{
+	PtyScreen *p = screenState();
+	char key;
+
+	if (p == NULL || !p->local)
+		return;	/* the server moves on by itself */
+	tcflush(STDIN_FILENO, TCIFLUSH);
+	read(STDIN_FILENO, &key, 1);
+}
+
+static void ptyFinish(void)
+{
+	PtyScreen *p = screenState();
+
+	if (p == NULL)
+		return;
+	if (p->fd == STDOUT_FILENO)
+	{
+		writeAll(p->fd, CLOSE_SCREEN, strlen(CLOSE_SCREEN));
+		if (p->local)
+			tcsetattr(STDIN_FILENO, TCSANOW, &p->saved);
+	}
+	else
+		writeAll(p->fd, RESET_SCREEN, strlen(RESET_SCREEN));
+	fprintf(stderr, "ansi session %d: %ld frames, %ld bytes, %.1f bytes/frame, largest %ld, %ld dropped\n",
+		currentSession()->id, p->frames, p->bytes, p->frames > 0 ? (double)p->bytes / p->frames : 0.0,
+		p->maxBytes, p->dropped);
+	free(p->want);
+	free(p->shown);
+	free(p->changed);
+	free(p->iov);
+	free(p->moves);
+	free(p);
+	currentSession()->backendState = NULL;
+}
+
+ConsoleBackend ptyBackend = {
+	ptyInit,
+	ptyDrawRow,
+	ptyPresent,
+	ptyWaitForKey,
+	ptyFinish
+};
@@ -0,0 +1,183 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file records and replays games. The journal is a small binary file: a header with the game seed and board size, then one record
+ * per key press stamped with the tick it was applied on, a checksum of the board every few ticks, and the tick the game
+ * stopped on. Since spawns come from per-lane generators seeded from the game seed and keys are only applied at tick
+ * boundaries, feeding the same keys back on the same ticks rebuilds the same boards.
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "replay.h"
+
+#define JOURNAL_MAGIC "FRGJ"
+#define JOURNAL_VERSION 4 //2 added the board size, 3 moved logs by fixed point velocity, 4 kept the game going while the frog respawns
+
+enum recordType {keyRecord = 1, checksumRecord = 2, endRecord = 3};
+
+typedef struct RECORD Record;
+struct RECORD {
+   uint32_t tick;
+   uint8_t type;
+   uint32_t value;
+};
+
+static FILE *journal = NULL;
+static bool replaying = false;
+static bool pending = false;  //`next' holds a record read ahead of its tick
+static Record next;
+static unsigned long checksums = 0;
+static unsigned long divergedAt = 0;
+static bool diverged = false;
+
+//---PROTOTYPES---------------------------------------------------------
+static void writeRecord(uint32_t tick, uint8_t type, uint32_t value);
+static bool readRecord(Record *record);
+static Record *peekRecord();
+//---METHODS------------------------------------------------------------//
+
+bool startRecording(const char *path, unsigned int seed, int cols, int lanes){
+   uint8_t version = JOURNAL_VERSION;
+   uint32_t seed32 = seed;
+   uint16_t size[2] = {cols, lanes};
+
+   journal = fopen(path, "wb");
+   if(journal != NULL){
+      fwrite(JOURNAL_MAGIC, 1, 4, journal);
+      fwrite(&version, sizeof(version), 1, journal);
+      fwrite(&seed32, sizeof(seed32), 1, journal);
+      fwrite(size, sizeof(size), 1, journal);
+   }
+   return journal != NULL;
+}
+
+bool startReplay(const char *path, unsigned int *seed, int *cols, int *lanes){
+   char magic[4];
+   uint8_t version;
+   uint32_t seed32;
+   uint16_t size[2];
+   bool success = false;
+
+   journal = fopen(path, "rb");
+   if(journal != NULL){
+      if(fread(magic, 1, 4, journal) == 4 && memcmp(magic, JOURNAL_MAGIC, 4) == 0 &&
+         fread(&version, sizeof(version), 1, journal) == 1 && version == JOURNAL_VERSION &&
+         fread(&seed32, sizeof(seed32), 1, journal) == 1 && fread(size, sizeof(size), 1, journal) == 1){
+         *seed = seed32;
+         *cols = size[0];
+         *lanes = size[1];
+         replaying = true;
+         success = true;
+      }
+      else{
+         fclose(journal);
+         journal = NULL;
+      }
+   }
+   return success;
+}
+
+bool isReplaying(){
+   return replaying;
+}
+
+bool isJournaling(){
+   return journal != NULL;
+}
+
+void recordKey(unsigned long tick, int key){
+   if(journal != NULL && !replaying){
+      writeRecord(tick, keyRecord, (uint8_t)key);
+   }
+}
+
+int replayKey(unsigned long tick){
+   int key = NO_KEY;
+   Record *record = peekRecord();
+   if(record != NULL && record->type == keyRecord && record->tick <= tick){
+      key = record->value;
+      pending = false;
+   }
+   return key;
+}
+
+void checkBoard(unsigned long tick, unsigned long checksum){
+   Record *record;
+   if(journal == NULL){
+      return;
+   }
+   if(!replaying){
+      writeRecord(tick, checksumRecord, (uint32_t)checksum);
+   }
+   else if((record = peekRecord()) != NULL && record->type == checksumRecord && record->tick <= tick){
+      checksums++;
+      if((record->tick != tick || record->value != (uint32_t)checksum) && !diverged){
+         diverged = true;
+         divergedAt = tick;
+      }
+      pending = false;
+   }
+}
+
+bool replayFinished(unsigned long tick){
+   Record *record = peekRecord();
+   return replaying && (record == NULL || (record->type == endRecord && record->tick <= tick));
+}
+
+bool stopJournal(unsigned long tick){
+   if(journal == NULL){
+      return true;
+   }
+   if(!replaying){
+      writeRecord(tick, endRecord, 0);
+   }
+   else if(diverged){
+      fprintf(stderr, "replay diverged from the recording at tick %lu\n", divergedAt);
+   }
+   else{
+      fprintf(stderr, "replay matched the recording (%lu board checks)\n", checksums);
+   }
+   fclose(journal);
+   journal = NULL;
+   return !diverged;
+}
+
+static void writeRecord(uint32_t tick, uint8_t type, uint32_t value){
+   uint8_t key;
+   fwrite(&tick, sizeof(tick), 1, journal);
+   fwrite(&type, sizeof(type), 1, journal);
+   if(type == keyRecord){ //keys only need a byte
+      key = value;
+      fwrite(&key, sizeof(key), 1, journal);
+   }
+   else if(type == checksumRecord){
+      fwrite(&value, sizeof(value), 1, journal);
+   }
+}
+
+static bool readRecord(Record *record){
+   uint8_t key;
+   bool success = fread(&record->tick, sizeof(record->tick), 1, journal) == 1 &&
+                  fread(&record->type, sizeof(record->type), 1, journal) == 1;
+   record->value = 0;
+   if(success && record->type == keyRecord){
+      success = fread(&key, sizeof(key), 1, journal) == 1;
+      record->value = key;
+   }
+   else if(success && record->type == checksumRecord){
+      success = fread(&record->value, sizeof(record->value), 1, journal) == 1;
+   }
+   return success;
+}
+
+static Record *peekRecord(){
+   if(!pending && journal != NULL && replaying){
+      pending = readRecord(&next);
+   }
+   return pending ? &next : NULL;
+}
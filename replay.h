@@ -0,0 +1,43 @@
+/* The header file for replay.c
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+#include <stdbool.h>
+
+#define NO_KEY -1
+#define CHECKSUM_TICKS 10 //how often the board is checksummed into the journal
+
+/* Opens a journal for writing and stores the game seed and board size in its
+   header */
+bool startRecording(const char *path, unsigned int seed, int cols, int lanes);
+
+/* Opens a journal for replay and reads the game seed and board size from its
+   header */
+bool startReplay(const char *path, unsigned int *seed, int *cols, int *lanes);
+
+/* Checks if a journal is being replayed */
+bool isReplaying();
+
+/* Checks if a journal is open, for recording or for replay */
+bool isJournaling();
+
+/* Writes a key press that was applied on the given tick */
+void recordKey(unsigned long tick, int key);
+
+/* Returns the next recorded key for the given tick, NO_KEY once there are no
+   more for that tick */
+int replayKey(unsigned long tick);
+
+/* Recording: writes the board checksum for the tick. Replay: compares it with
+   the recorded one and remembers the first tick that differs */
+void checkBoard(unsigned long tick, unsigned long checksum);
+
+/* Checks if the replay has reached the tick the recording stopped on */
+bool replayFinished(unsigned long tick);
+
+/* Writes the final tick if recording and closes the journal. Returns false if a
+   replay did not reproduce the recorded boards */
+bool stopJournal(unsigned long tick);
+
+#endif
@@ -0,0 +1,271 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file runs many games in one process. Every session gets its own pseudo-terminal that a player attaches to
+ * (e.g. `screen /dev/pts/7'), and a fixed pool of worker threads steps the sessions: worker w owns sessions w, w+N,
+ * w+2N... and runs one tick of each of them per tick. The main thread sleeps in epoll on every terminal and hands
+ * the keys it reads to their session. A session whose game ended starts a new one after a short pause.
+ *
+ */
+
+#define _XOPEN_SOURCE 600 //posix_openpt and friends
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#include "server.h"
+#include "session.h"
+#include "console.h"
+#include "frogger.h"
+#include "gameglobals.h"
+#include "threadwrappers.h"
+#include "input.h"
+#include "events.h"
+
+#define RESTART_TICKS 300 //how long the end banner stays up before the next game
+#define READ_SIZE 64
+#define MAX_READY 64
+
+typedef struct SERVER_SLOT ServerSlot;
+struct SERVER_SLOT {
+   Session *session;
+   Subscriber *lives;
+   int slaveFd;   //kept open so the terminal stays up between players
+   unsigned int seed;
+   int ticksToRestart;
+};
+
+typedef struct WORKER Worker;
+struct WORKER {
+   pthread_t thread;
+   int first;
+};
+
+static ServerSlot *slots;
+static int numSlots;
+static int numWorkers;
+static atomic_int stopping = 0; //set by the signal handler on the main thread, read by the workers too
+static ShutdownToken workersDone; //wakes the workers from their tick wait once the server stops
+
+//---PROTOTYPES---------------------------------------------------------
+static bool openTerminal(ServerSlot *slot, int id);
+static void serve(int epollFd, Worker *pool);
+static void startSession(ServerSlot *slot);
+static void stopSession(ServerSlot *slot);
+static void serveTick(ServerSlot *slot);
+static void *runWorker(void *arg);
+static void readTerminals(int epollFd);
+static void stopServer(int sig);
+//---METHODS------------------------------------------------------------//
+
+bool runServer(int sessions, int workers, unsigned int seed){
+   Session *local = currentSession(); //holds the board size picked on the command line
+   struct epoll_event event;
+   Worker *pool;
+   int epollFd;
+   int opened, i;
+
+   numSlots = sessions;
+   numWorkers = workers < sessions ? workers : sessions;
+   slots = (ServerSlot *)calloc(numSlots, sizeof(ServerSlot));
+   pool = (Worker *)calloc(numWorkers, sizeof(Worker));
+   if(slots == NULL || pool == NULL || (epollFd = epoll_create1(EPOLL_CLOEXEC)) == -1){
+      printError();
+   }
+
+   for(opened = 0; opened < numSlots && openTerminal(&slots[opened], opened); opened++){
+      slots[opened].session->numCols = local->numCols;
+      slots[opened].session->numLanes = local->numLanes;
+      slots[opened].seed = seed + opened;
+      event.events = EPOLLIN;
+      event.data.u32 = opened;
+      if(epoll_ctl(epollFd, EPOLL_CTL_ADD, slots[opened].session->ttyFd, &event) == -1){
+         printError();
+      }
+      startSession(&slots[opened]);
+   }
+   setCurrentSession(local);
+   if(opened < numSlots){ //the sessions already going are stopped again below
+      fprintf(stderr, "Can't open a terminal for session %d\n", opened);
+   }
+   else{
+      fflush(stdout);
+      serve(epollFd, pool);
+   }
+
+   for(i = 0; i < opened; i++){
+      stopSession(&slots[i]);
+   }
+   setCurrentSession(local);
+   close(epollFd);
+   free(pool);
+   free(slots);
+   return opened == numSlots;
+}
+
+/* Runs the workers and reads the terminals until the server is told to stop */
+static void serve(int epollFd, Worker *pool){
+   struct sigaction action;
+   sigset_t stopSignals;
+   int i;
+
+   memset(&action, 0, sizeof(action));
+   action.sa_handler = stopServer; //no SA_RESTART, epoll_wait has to come back
+   sigaction(SIGINT, &action, NULL);
+   sigaction(SIGTERM, &action, NULL);
+   sigemptyset(&stopSignals);
+   sigaddset(&stopSignals, SIGINT);
+   sigaddset(&stopSignals, SIGTERM);
+
+   shutdownInit(&workersDone);
+   //workers are started with the stop signals blocked so they always land on this thread's epoll_wait
+   pthread_sigmask(SIG_BLOCK, &stopSignals, NULL);
+   for(i = 0; i < numWorkers; i++){
+      pool[i].first = i;
+      createThread(&pool[i].thread, runWorker, &pool[i]);
+   }
+   pthread_sigmask(SIG_UNBLOCK, &stopSignals, NULL);
+   readTerminals(epollFd);
+   shutdownCancel(&workersDone); //the signal handler can't, so it's done once epoll_wait is back
+   for(i = 0; i < numWorkers; i++){
+      joinThread(pool[i].thread);
+   }
+   shutdownDestroy(&workersDone);
+}
+
+/* A raw pseudo-terminal per session. The master side is the session's console
+   and input, the slave is printed for a player to attach to */
+static bool openTerminal(ServerSlot *slot, int id){
+   struct termios raw;
+   char *slaveName;
+   int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+   if(master == -1){
+      return false;
+   }
+   if(grantpt(master) == -1 || unlockpt(master) == -1 || (slaveName = ptsname(master)) == NULL){
+      close(master);
+      return false;
+   }
+   slot->slaveFd = open(slaveName, O_RDWR | O_NOCTTY | O_CLOEXEC);
+   if(slot->slaveFd == -1 || tcgetattr(slot->slaveFd, &raw) == -1){
+      if(slot->slaveFd != -1){
+         close(slot->slaveFd);
+      }
+      close(master);
+      return false;
+   }
+   cfmakeraw(&raw);
+   raw.c_cflag |= CLOCAL; //no modem, opening the terminal must not wait for carrier
+   tcsetattr(slot->slaveFd, TCSANOW, &raw);
+   slot->session = newSession(id, master);
+   printf("session %d: %s\n", id, slaveName);
+   return true;
+}
+
+static void startSession(ServerSlot *slot){
+   setCurrentSession(slot->session);
+   initLocks();
+   initEvents();
+   initActionQueue();
+   slot->lives = subscribe(EVENT_BIT(frogDied));
+   consoleSelectBackend(PTY_CONSOLE, NULL);
+   if(!openGame(slot->seed)){
+      printError();
+   }
+}
+
+static void stopSession(ServerSlot *slot){
+   setCurrentSession(slot->session);
+   destroyEvents();
+   deleteInput();
+   closeGame();
+   destroyLocks();
+   close(slot->session->ttyFd);
+   close(slot->slaveFd);
+   freeSession(slot->session);
+}
+
+/* One tick of one session, on the worker that owns it. The frog's deaths are
+   picked up after the tick, like runGame does */
+static void serveTick(ServerSlot *slot){
+   GameEvent event;
+
+   setCurrentSession(slot->session);
+   if(isGameOver()){
+      if(--slot->ticksToRestart <= 0){
+         closeGame();
+         slot->seed += numSlots;
+         if(!openGame(slot->seed)){
+            printError();
+         }
+      }
+      return;
+   }
+   stepGame();
+   while(pollEvent(slot->lives, &event)){
+      loseLife();
+   }
+   consoleRefresh();
+   if(isGameOver()){
+      slot->ticksToRestart = RESTART_TICKS;
+   }
+}
+
+/* Steps its sessions once per tick on a fixed timestep, so the time a round
+   takes doesn't add up into drift, and catches up on rounds it fell behind on */
+static void *runWorker(void *arg){
+   Worker *worker = (Worker *)arg;
+   TickClock clock;
+   int due, i;
+
+   tickClockStart(&clock, &workersDone);
+   while(!atomic_load(&stopping)){
+      due = tickClockWait(&clock);
+      while(due-- > 0 && !atomic_load(&stopping)){
+         for(i = worker->first; i < numSlots; i += numWorkers){
+            serveTick(&slots[i]);
+         }
+      }
+   }
+   pthread_exit(NULL);
+}
+
+/* Feeds the keys from every terminal to its session until the server is told
+   to stop */
+static void readTerminals(int epollFd){
+   struct epoll_event ready[MAX_READY];
+   unsigned char keys[READ_SIZE];
+   ServerSlot *slot;
+   int ret, count, i;
+
+   while(!atomic_load(&stopping)){
+      ret = epoll_wait(epollFd, ready, MAX_READY, -1);
+      if(ret == -1 && errno != EINTR){
+         printError();
+      }
+      for(i = 0; i < ret; i++){
+         slot = &slots[ready[i].data.u32];
+         while((count = read(slot->session->ttyFd, keys, READ_SIZE)) > 0){
+            setCurrentSession(slot->session);
+            feedKeys(keys, count, inputClock());
+         }
+      }
+   }
+}
+
+static void stopServer(int sig){
+   atomic_store(&stopping, 1); //lock free, so safe in a signal handler
+}
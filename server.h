@@ -0,0 +1,14 @@
+/* The header file for server.c
+*/
+
+#ifndef SERVER_H
+#define SERVER_H
+#include <stdbool.h>
+
+/* Runs `sessions' games, each on its own pseudo-terminal, stepped by a pool
+   of `workers' threads. Session i is seeded with seed+i and uses the board
+   size of the current session. Returns on SIGINT or SIGTERM, or false if
+   the terminals can't be set up */
+bool runServer(int sessions, int workers, unsigned int seed);
+
+#endif
@@ -0,0 +1,53 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file holds game sessions. Everything one game needs, from the frog to the framebuffer, lives in its session
+ * instead of in globals, so one process can run many games side by side. Each thread has a current session that
+ * the game functions work on; threads a session starts inherit it, and server workers switch it as they go from one
+ * session to the next.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "session.h"
+#include "frogger.h"
+#include "events.h"
+#include "console.h"
+#include "threadwrappers.h"
+
+static __thread Session *current = NULL;
+
+Session *newSession(int id, int ttyFd){
+   Session *session = (Session *)calloc(1, sizeof(Session));
+   if(session == NULL){
+      printError();
+   }
+   session->id = id;
+   session->ttyFd = ttyFd;
+   session->numCols = DEFAULT_COLS;
+   session->numLanes = DEFAULT_LANES;
+   session->lives = MAX_LIVES;
+   shutdownInit(&session->shutdown);
+   return session;
+}
+
+void freeSession(Session *session){
+   Session *caller = current;
+   current = session;
+   freeEvents();
+   consoleFree();
+   current = caller == session ? NULL : caller;
+   shutdownDestroy(&session->shutdown);
+   free(session);
+}
+
+Session *currentSession(){
+   return current;
+}
+
+void setCurrentSession(Session *session){
+   current = session;
+}
@@ -0,0 +1,50 @@
+/* The header file for session.c
+*/
+
+#ifndef SESSION_H
+#define SESSION_H
+#include <stdbool.h>
+#include <pthread.h>
+#include "gameglobals.h"
+#include "console.h"
+
+typedef struct SESSION Session;
+struct SESSION {
+   int id;
+   int ttyFd;   //pseudo-terminal the session is played on, -1 for the local game
+   bool gameOver;
+   int threadCount;
+   unsigned long tick;
+   int numCols, numLanes;
+   int lives;
+   ShutdownToken shutdown; //cancelled when the game ends, wakes every thread of the game that is waiting on the clock
+   pthread_mutex_t playerLock, threadCountLock;
+   pthread_t tids[NUM_THREADS];
+   //the rest of the state belongs to one file each and only that file looks inside
+   struct CONSOLE_STATE *console;
+   void *backendState; //whatever the console backend keeps per session
+   struct PLAYER_STATE *player;
+   struct LOG_STATE *logs;
+   struct LANE_STATE *lanes;
+   struct EPOCH_STATE *epochs;
+   struct EVENT_STATE *events;
+   struct INPUT_STATE *input;
+   struct CAST_STATE *cast;
+   struct TIMER_STATE *timers;
+};
+
+/* Makes a session for a fresh game on the default board. `ttyFd' is the
+   terminal it is played on, -1 for the local one */
+Session *newSession(int id, int ttyFd);
+
+/* Frees the session. Its game has to be closed already */
+void freeSession(Session *session);
+
+/* Returns the session the calling thread is working on */
+Session *currentSession();
+
+/* Points the calling thread at a session. Every game function after this
+   works on that session's state */
+void setCurrentSession(Session *session);
+
+#endif
@@ -0,0 +1,437 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file saves a game so it can be picked up again later, after a crash or on another machine. The snapshot is one
+ * fixed layout binary file: a header with the version, board size, tick and a checksum, then the frog, one record per
+ * lane with its spawn schedule, and the lane's logs oldest first. Every field has a fixed width, so the file is the same
+ * size whatever the compiler does with the game's own structs; it is written in the machine's byte order, which the
+ * version check catches. Restoring maps the file and copies it straight into a freshly opened game, so it only costs
+ * as much as the logs on the board.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "session.h"
+#include "console.h"
+#include "gameglobals.h"
+#include "frogger.h"
+#include "player.h"
+#include "log.h"
+#include "lanes.h"
+#include "threadwrappers.h"
+
+typedef struct SNAP_HEADER SnapHeader;
+struct SNAP_HEADER {
+   char magic[8];
+   uint32_t version;
+   uint32_t size;     //whole file, header included
+   uint64_t tick;
+   int32_t lives;
+   int32_t cols, lanes;
+   int32_t numLogs;
+   uint32_t checksum; //FNV-1a of everything after the header
+   uint32_t unused;
+};
+
+typedef struct SNAP_FROG SnapFrog;
+struct SNAP_FROG {
+   int32_t prevPos[2];
+   int32_t currPos[2];
+   int32_t animateState;
+   int32_t blinkSpeed;
+   int32_t ticksToBlink;
+   int32_t ticksToRespawn;
+   int32_t height, width;
+   uint8_t onLog, dead;
+   uint8_t podFull[NUM_PODS];
+   uint8_t unused;
+};
+
+typedef struct SNAP_LANE SnapLane;
+struct SNAP_LANE {
+   int32_t row;
+   int32_t ticksToSpawn;
+   uint32_t rng;
+   int32_t numLogs;
+};
+
+typedef struct SNAP_LOG SnapLog;
+struct SNAP_LOG {
+   int32_t pos, velocity;
+   int32_t prevCol, currCol;
+   int32_t width, height;
+   int32_t startRow;
+   uint8_t direction, animateState, dead, hasFrog;
+};
+
+//the layout is the file format, a struct that changes size needs a new version
+_Static_assert(sizeof(SnapHeader) == 48, "snapshot header layout changed");
+_Static_assert(sizeof(SnapFrog) == 48, "snapshot frog layout changed");
+_Static_assert(sizeof(SnapLane) == 16, "snapshot lane layout changed");
+_Static_assert(sizeof(SnapLog) == 32, "snapshot log layout changed");
+
+static const unsigned char *mapped = NULL; //the loaded snapshot, until it's restored
+static size_t mappedSize = 0;
+static unsigned long savedTick = 0;
+static long restoreMicros = 0;
+
+//---PROTOTYPES---------------------------------------------------------
+static uint32_t checksum(const unsigned char *bytes, size_t len);
+static size_t snapshotSize(int lanes, int numLogs);
+static void saveFrog(SnapFrog *out);
+static int saveLane(int i, SnapLane *out, SnapLog *logs);
+static bool writeFile(const char *path, const unsigned char *bytes, size_t len);
+static bool syncDirectory(const char *path);
+static bool validSnapshot(const unsigned char *bytes, size_t len);
+static Log *restoreLane(int i, const SnapLane *saved, const SnapLog *logs);
+static void unmapSnapshot();
+static long elapsedMicros(struct timespec *start);
+//---METHODS------------------------------------------------------------//
+
+bool saveSnapshot(const char *path){
+   Session *session = currentSession();
+   SnapHeader *header;
+   SnapLane *lanes;
+   SnapLog *logs;
+   unsigned char *bytes;
+   int numLanes = laneCount();
+   int numLogs = 0;
+   size_t size;
+   bool success;
+   int i;
+
+   for(i = 0; i < numLanes; i++){
+      numLogs += laneAt(i)->count;
+   }
+   size = snapshotSize(numLanes, numLogs);
+   if((bytes = (unsigned char *)calloc(1, size)) == NULL){
+      return false;
+   }
+   header = (SnapHeader *)bytes;
+   lanes = (SnapLane *)(bytes + sizeof(SnapHeader) + sizeof(SnapFrog));
+   logs = (SnapLog *)(lanes + numLanes);
+
+   lockMutex(playerLock());
+   saveFrog((SnapFrog *)(bytes + sizeof(SnapHeader)));
+   unlockMutex(playerLock());
+   for(i = 0; i < numLanes; i++){
+      logs += saveLane(i, &lanes[i], logs);
+   }
+
+   memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+   header->version = SNAPSHOT_VERSION;
+   header->size = size;
+   header->tick = session->tick;
+   header->lives = session->lives;
+   header->cols = boardCols();
+   header->lanes = numLanes;
+   header->numLogs = numLogs;
+   header->checksum = checksum(bytes + sizeof(SnapHeader), size - sizeof(SnapHeader));
+   success = writeFile(path, bytes, size);
+   free(bytes);
+   return success;
+}
+
+bool loadSnapshot(const char *path, int *cols, int *lanes){
+   struct stat info;
+   void *bytes;
+   int fd;
+
+   unmapSnapshot();
+   if((fd = open(path, O_RDONLY)) < 0){
+      return false;
+   }
+   if(fstat(fd, &info) < 0 || info.st_size < (off_t)sizeof(SnapHeader)){
+      close(fd);
+      return false;
+   }
+   bytes = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd); //the mapping stays good without it
+   if(bytes == MAP_FAILED){
+      return false;
+   }
+   mapped = (const unsigned char *)bytes;
+   mappedSize = info.st_size;
+   if(!validSnapshot(mapped, mappedSize)){
+      unmapSnapshot();
+      return false;
+   }
+   savedTick = ((const SnapHeader *)mapped)->tick;
+   *cols = ((const SnapHeader *)mapped)->cols;
+   *lanes = ((const SnapHeader *)mapped)->lanes;
+   return true;
+}
+
+bool snapshotLoaded(){
+   return mapped != NULL;
+}
+
+bool restoreSnapshot(){
+   Session *session = currentSession();
+   const SnapHeader *header = (const SnapHeader *)mapped;
+   const SnapFrog *savedFrog;
+   const SnapLane *lanes;
+   const SnapLog *logs;
+   Log *carrier = NULL;
+   Log *laneCarrier;
+   Frog frog;
+   char strLives[12];
+   struct timespec start;
+   int i;
+
+   if(mapped == NULL || header->cols != boardCols() || header->lanes != laneCount()){
+      return false;
+   }
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   savedFrog = (const SnapFrog *)(mapped + sizeof(SnapHeader));
+   lanes = (const SnapLane *)(mapped + sizeof(SnapHeader) + sizeof(SnapFrog));
+   logs = (const SnapLog *)(lanes + header->lanes);
+
+   session->tick = header->tick;
+   session->lives = header->lives;
+   snprintf(strLives, sizeof(strLives), "%d", session->lives);
+   putString(strLives, 0, livesCol(), 1);
+   for(i = 0; i < header->lanes; i++){
+      if((laneCarrier = restoreLane(i, &lanes[i], logs)) != NULL){
+         carrier = laneCarrier;
+      }
+      logs += lanes[i].numLogs;
+   }
+
+   frog.prevPos[0] = savedFrog->prevPos[0];
+   frog.prevPos[1] = savedFrog->prevPos[1];
+   frog.currPos[0] = savedFrog->currPos[0];
+   frog.currPos[1] = savedFrog->currPos[1];
+   frog.animateState = savedFrog->animateState;
+   frog.blinkSpeed = savedFrog->blinkSpeed;
+   frog.height = savedFrog->height;
+   frog.width = savedFrog->width;
+   frog.onLog = savedFrog->onLog;
+   frog.dead = savedFrog->dead;
+   for(i = 0; i < NUM_PODS; i++){
+      frog.podFull[i] = savedFrog->podFull[i];
+   }
+   restorePlayer(&frog, savedFrog->ticksToBlink, savedFrog->ticksToRespawn, carrier);
+
+   unmapSnapshot();
+   restoreMicros = elapsedMicros(&start);
+   return true;
+}
+
+unsigned long snapshotTick(){
+   return savedTick;
+}
+
+long snapshotRestoreMicros(){
+   return restoreMicros;
+}
+
+/* 32 bit FNV-1a, enough to catch a torn or damaged file */
+static uint32_t checksum(const unsigned char *bytes, size_t len){
+   uint32_t hash = 2166136261u;
+   size_t i;
+   for(i = 0; i < len; i++){
+      hash = (hash ^ bytes[i]) * 16777619u;
+   }
+   return hash;
+}
+
+static size_t snapshotSize(int lanes, int numLogs){
+   return sizeof(SnapHeader) + sizeof(SnapFrog) + (size_t)lanes * sizeof(SnapLane) + (size_t)numLogs * sizeof(SnapLog);
+}
+
+/* Caller holds the player lock */
+static void saveFrog(SnapFrog *out){
+   Frog *frog = getFrog();
+   int i;
+   out->prevPos[0] = frog->prevPos[0];
+   out->prevPos[1] = frog->prevPos[1];
+   out->currPos[0] = frog->currPos[0];
+   out->currPos[1] = frog->currPos[1];
+   out->animateState = frog->animateState;
+   out->blinkSpeed = frog->blinkSpeed;
+   out->ticksToBlink = blinkTicks();
+   out->ticksToRespawn = respawnTicks();
+   out->height = frog->height;
+   out->width = frog->width;
+   out->onLog = frog->onLog;
+   out->dead = frog->dead;
+   for(i = 0; i < NUM_PODS; i++){
+      out->podFull[i] = frog->podFull[i];
+   }
+}
+
+/* Saves the lane's schedule and its logs oldest first. Returns how many logs it saved */
+static int saveLane(int i, SnapLane *out, SnapLog *logs){
+   LaneSchedule *schedule = laneSchedule(i);
+   Lane *lane = laneAt(i);
+   LaneIter iter;
+   Log *log;
+   int count = 0;
+
+   out->row = schedule->row;
+   out->ticksToSpawn = schedule->ticksToSpawn;
+   out->rng = schedule->rng;
+   lockMutex(&lane->lock);
+   laneIterInit(&iter, lane);
+   while((log = laneIterNext(&iter)) != NULL){
+      logs[count].pos = laneLogPos(lane, count);
+      logs[count].velocity = log->velocity;
+      logs[count].prevCol = log->prevCol;
+      logs[count].currCol = log->currCol;
+      logs[count].width = log->width;
+      logs[count].height = log->height;
+      logs[count].startRow = log->startRow;
+      logs[count].direction = log->direction;
+      logs[count].animateState = log->animateState;
+      logs[count].dead = log->dead;
+      logs[count].hasFrog = log->hasFrog;
+      count++;
+   }
+   unlockMutex(&lane->lock);
+   out->numLogs = count;
+   return count;
+}
+
+/* Writes to a temporary file and renames it over `path' once it is on disk */
+static bool writeFile(const char *path, const unsigned char *bytes, size_t len){
+   char tmpPath[strlen(path) + 5];
+   ssize_t written = 0;
+   ssize_t count = 0;
+   int fd;
+
+   sprintf(tmpPath, "%s.tmp", path);
+   if((fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0){
+      return false;
+   }
+   while(written < (ssize_t)len && (count = write(fd, bytes + written, len - written)) > 0){
+      written += count;
+   }
+   if(written != (ssize_t)len || fsync(fd) < 0){
+      close(fd);
+      unlink(tmpPath);
+      return false;
+   }
+   close(fd);
+   if(rename(tmpPath, path) < 0){
+      unlink(tmpPath);
+      return false;
+   }
+   return syncDirectory(path);
+}
+
+/* Flushes the directory holding `path', so the rename that put the file
+   there survives a crash too */
+static bool syncDirectory(const char *path){
+   char dirPath[strlen(path) + 2];
+   char *slash;
+   bool synced;
+   int fd;
+
+   strcpy(dirPath, path);
+   if((slash = strrchr(dirPath, '/')) == NULL){
+      strcpy(dirPath, ".");
+   }
+   else if(slash == dirPath){ //a file in the root
+      dirPath[1] = '\0';
+   }
+   else{
+      *slash = '\0';
+   }
+   if((fd = open(dirPath, O_RDONLY | O_DIRECTORY)) < 0){
+      return false;
+   }
+   synced = fsync(fd) == 0;
+   close(fd);
+   return synced;
+}
+
+/* Checks everything restoreSnapshot relies on, so a bad file is turned away
+   before the game is opened instead of half way through restoring it */
+static bool validSnapshot(const unsigned char *bytes, size_t len){
+   const SnapHeader *header = (const SnapHeader *)bytes;
+   const SnapFrog *frog = (const SnapFrog *)(bytes + sizeof(SnapHeader));
+   const SnapLane *lanes = (const SnapLane *)(bytes + sizeof(SnapHeader) + sizeof(SnapFrog));
+   int numLogs = 0;
+   int i;
+
+   if(memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 || header->version != SNAPSHOT_VERSION ||
+      header->size != len || header->lanes < 1 || header->lanes > MAX_LANES || header->numLogs < 0 ||
+      header->lives < 1 || header->lives > MAX_LIVES || len != snapshotSize(header->lanes, header->numLogs)){
+      return false;
+   }
+   for(i = 0; i < header->lanes; i++){
+      if(lanes[i].numLogs < 0){
+         return false;
+      }
+      numLogs += lanes[i].numLogs;
+   }
+   return numLogs == header->numLogs && frog->ticksToRespawn >= 0 && frog->ticksToRespawn <= RESPAWN_TICKS &&
+      header->checksum == checksum(bytes + sizeof(SnapHeader), len - sizeof(SnapHeader));
+}
+
+/* Puts the lane's schedule back and fills it with its saved logs, oldest first.
+   Returns the log carrying the frog, NULL if it isn't in this lane */
+static Log *restoreLane(int i, const SnapLane *saved, const SnapLog *logs){
+   LaneSchedule *schedule = laneSchedule(i);
+   Lane *lane = laneAt(i);
+   Log *carrier = NULL;
+   Log *log;
+   int j;
+
+   schedule->ticksToSpawn = saved->ticksToSpawn;
+   schedule->rng = saved->rng;
+   lockMutex(&lane->lock);
+   while((log = laneFront(lane)) != NULL){ //openGame leaves the lanes empty, but be sure
+      laneRemove(lane, log);
+   }
+   for(j = 0; j < saved->numLogs && (log = allocLog()) != NULL; j++){
+      log->velocity = logs[j].velocity;
+      log->prevCol = logs[j].prevCol;
+      log->currCol = logs[j].currCol;
+      log->width = logs[j].width;
+      log->height = logs[j].height;
+      log->startRow = logs[j].startRow;
+      log->direction = logs[j].direction;
+      log->animateState = logs[j].animateState;
+      log->dead = logs[j].dead;
+      log->hasFrog = logs[j].hasFrog;
+      log->lane = NULL;
+      if(!laneInsert(lane, log)){
+         freeLog(log);
+         continue;
+      }
+      laneSetLogPos(lane, lane->count - 1, logs[j].pos);
+      if(log->hasFrog){
+         carrier = log;
+      }
+   }
+   unlockMutex(&lane->lock);
+   return carrier;
+}
+
+static void unmapSnapshot(){
+   if(mapped != NULL){
+      munmap((void *)mapped, mappedSize);
+   }
+   mapped = NULL;
+   mappedSize = 0;
+}
+
+static long elapsedMicros(struct timespec *start){
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000;
+}
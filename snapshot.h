@@ -0,0 +1,35 @@
+/* The header file for snapshot.c
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <stdbool.h>
+
+#define SNAPSHOT_MAGIC "FROGSNAP"
+#define SNAPSHOT_VERSION 2 //2 saved the frog's respawn
+
+/* Writes the current session's game to `path' so it can be picked up again at
+   the same tick. The file is written next to `path' and renamed over it, so a
+   crash leaves either the old snapshot or the new one. Returns false if it
+   can't be written */
+bool saveSnapshot(const char *path);
+
+/* Maps a snapshot and checks it, and reads the board size it was saved with so
+   the board can be set up to match before the game is opened. Returns false if
+   the file is missing, from another version or damaged */
+bool loadSnapshot(const char *path, int *cols, int *lanes);
+
+/* Checks if a snapshot is loaded and waiting to be restored */
+bool snapshotLoaded();
+
+/* Puts the loaded snapshot into the current session's freshly opened game: the
+   tick, lives, spawn schedules, every log and the frog, then unmaps it */
+bool restoreSnapshot();
+
+/* Returns the tick the snapshot was saved on */
+unsigned long snapshotTick();
+
+/* Returns how long the last restore took, in microseconds */
+long snapshotRestoreMicros();
+
+#endif
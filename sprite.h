@@ -0,0 +1,37 @@
+/**********************************************************************
+  Module: sprite.h
+
+  Purpose: Sprites as the draw functions in console.h take them, with
+	   everything about their shape worked out when the game is built.
+
+  NOTES: the sprites themselves are in sprites.txt; spritegen turns
+	 them into sprites.c and sprites.h, declaring one `<name>Sprite'
+	 each. Every row is padded to the sprite's width, so drawing one
+	 never has to look for the end of a string.
+**********************************************************************/
+
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <stdbool.h>
+
+typedef struct SPRITE_ROW SpriteRow;
+struct SPRITE_ROW {
+	const char *cells;	/* `width' cells */
+	short first, length;	/* span from the first to the last non blank cell */
+	bool solid;		/* no blanks inside the span, so a transparent draw is a plain copy */
+};
+
+typedef struct SPRITE Sprite;
+struct SPRITE {
+	const char *name;
+	short width, height, frames;
+	const SpriteRow *rows;	/* frames*height rows, one frame after the other */
+};
+
+/* Row `row' of animation frame `frame' */
+#define SPRITE_ROW(sprite, frame, row) (&(sprite)->rows[(frame)*(sprite)->height + (row)])
+
+#include "sprites.h"
+
+#endif /* SPRITE_H */
@@ -0,0 +1,186 @@
+/**********************************************************************
+  Module: spritegen.c
+
+  Purpose: Build step that compiles sprites.txt into sprite tables.
+	   usage: spritegen sprites.txt sprites.c sprites.h
+
+  NOTES: the format is described at the top of sprites.txt. Every
+	 frame of a sprite has to have the same number of rows; the width
+	 is the longest row of any frame.
+**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define MAX_LINE 256
+#define MAX_SPRITES 32
+#define MAX_ROWS 64	/* all frames of one sprite */
+#define MAX_NAME 32
+
+typedef struct SOURCE_SPRITE SourceSprite;
+struct SOURCE_SPRITE {
+	char name[MAX_NAME];
+	char rows[MAX_ROWS][MAX_LINE];
+	int numRows, frames, height, width;
+	int rowsInFrame;	/* of the frame being read */
+};
+
+static SourceSprite sprites[MAX_SPRITES];
+static int numSprites = 0;
+
+/* Local functions */
+
+static void fail(const char *path, int line, const char *why)
+{
+	fprintf(stderr, "%s:%d: %s\n", path, line, why);
+	exit(1);
+}
+
+/* Checks the frame just finished is as tall as the others */
+static void endFrame(SourceSprite *s, const char *path, int line)
+{
+	if (s == NULL || s->frames == 0)
+		return;
+	if (s->rowsInFrame == 0)
+		fail(path, line, "empty frame");
+	if (s->height == 0)
+		s->height = s->rowsInFrame;
+	else if (s->rowsInFrame != s->height)
+		fail(path, line, "frames of a sprite need the same number of rows");
+}
+
+static void readSprites(const char *path)
+{
+	FILE *in = fopen(path, "r");
+	char line[MAX_LINE];
+	SourceSprite *s = NULL;
+	int lineNumber = 0;
+	int len;
+
+	if (in == NULL)
+		fail(path, 0, "can't open");
+	while (fgets(line, MAX_LINE, in) != NULL)
+	{
+		lineNumber++;
+		len = strcspn(line, "\r\n");
+		line[len] = '\0';
+		if (strncmp(line, "sprite ", 7) == 0)
+		{
+			endFrame(s, path, lineNumber);
+			if (numSprites == MAX_SPRITES)
+				fail(path, lineNumber, "too many sprites");
+			s = &sprites[numSprites++];
+			snprintf(s->name, MAX_NAME, "%s", line + 7);
+		}
+		else if (strcmp(line, "frame") == 0)
+		{
+			if (s == NULL)
+				fail(path, lineNumber, "frame outside a sprite");
+			endFrame(s, path, lineNumber);
+			s->frames++;
+			s->rowsInFrame = 0;
+		}
+		else if (line[0] == '#' || len == 0)
+			continue;
+		else
+		{
+			if (s == NULL || s->frames == 0)
+				fail(path, lineNumber, "row outside a frame");
+			if (s->numRows == MAX_ROWS)
+				fail(path, lineNumber, "sprite too big");
+			strcpy(s->rows[s->numRows++], line);
+			s->rowsInFrame++;
+			if (len > s->width)
+				s->width = len;
+		}
+	}
+	endFrame(s, path, lineNumber);
+	fclose(in);
+}
+
+/* The row padded to the sprite width as a C string literal */
+static void writeCells(FILE *out, const char *row, int width)
+{
+	int i;
+
+	fputc('"', out);
+	for (i = 0; i < width; i++)
+	{
+		if (i < strlen(row))
+		{
+			if (row[i] == '"' || row[i] == '\\')
+				fputc('\\', out);
+			fputc(row[i], out);
+		}
+		else
+			fputc(' ', out);
+	}
+	fputc('"', out);
+}
+
+static void writeSource(FILE *out, const char *headerName)
+{
+	SourceSprite *s;
+	const char *row;
+	int first, last, i, j, k;
+	bool solid;
+
+	fprintf(out, "/* Generated by spritegen from sprites.txt, edit that instead */\n\n");
+	fprintf(out, "#include \"sprite.h\"\n#include \"%s\"\n", headerName);
+	for (i = 0; i < numSprites; i++)
+	{
+		s = &sprites[i];
+		fprintf(out, "\nstatic const SpriteRow %sRows[] = {\n", s->name);
+		for (j = 0; j < s->numRows; j++)
+		{
+			row = s->rows[j];
+			for (first = 0; row[first] == ' '; first++);
+			for (last = strlen(row) - 1; last >= first && row[last] == ' '; last--);
+			solid = true;
+			for (k = first; k <= last; k++)
+				solid = solid && row[k] != ' ';
+			fprintf(out, "\t{");
+			writeCells(out, row, s->width);
+			fprintf(out, ", %d, %d, %s},\n", first, last - first + 1, solid ? "true" : "false");
+		}
+		fprintf(out, "};\n");
+		fprintf(out, "const Sprite %sSprite = {\"%s\", %d, %d, %d, %sRows};\n",
+			s->name, s->name, s->width, s->height, s->frames, s->name);
+	}
+}
+
+static void writeHeader(FILE *out)
+{
+	int i;
+
+	fprintf(out, "/* Generated by spritegen from sprites.txt, edit that instead */\n\n");
+	fprintf(out, "#ifndef SPRITES_H\n#define SPRITES_H\n\n#include \"sprite.h\"\n\n");
+	for (i = 0; i < numSprites; i++)
+		fprintf(out, "extern const Sprite %sSprite;\n", sprites[i].name);
+	fprintf(out, "\n#endif /* SPRITES_H */\n");
+}
+
+int main(int argc, char **argv)
+{
+	FILE *source, *header;
+	const char *headerName;
+
+	if (argc != 4)
+	{
+		fprintf(stderr, "usage: %s sprites.txt sprites.c sprites.h\n", argv[0]);
+		return (1);
+	}
+	readSprites(argv[1]);
+	source = fopen(argv[2], "w");
+	header = fopen(argv[3], "w");
+	if (source == NULL || header == NULL)
+		fail(argv[2], 0, "can't write");
+	headerName = strrchr(argv[3], '/') != NULL ? strrchr(argv[3], '/') + 1 : argv[3];
+	writeSource(source, headerName);
+	writeHeader(header);
+	fclose(source);
+	fclose(header);
+	return (0);
+}
@@ -3,24 +3,94 @@
  * REBECCA TIESSEN
  *
  * This file is a wrapper for the pthread methods in order to check for errors. An error will print and the program will exit if 
- * a method errors.
+ * a method errors. When lock statistics are turned on the lock wrappers also time how long every lock was waited for and
+ * held, per named lock, and remember the call site that waited or held the longest. When tracing is on, every wait for a
+ * lock another thread holds is traced too.
 */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
 #include <pthread.h>
 #include "threadwrappers.h"
 #include "gameglobals.h"
+#include "session.h"
+#include "trace.h"
+
+#define STATS_CHUNK 64 //entries are added a chunk at a time and never move, so lookups don't need the lock
+#define MAX_STATS_CHUNKS 64
+#define MAX_TRACKED_LOCKS (STATS_CHUNK * MAX_STATS_CHUNKS)
+#define HIST_BUCKETS 32 //bucket i counts times from 2^i to 2^(i+1) ns
+#define LOCK_NAME_LEN 32
+#define NSEC_PER_SEC 1000000000L
+
+//the report can be written while other threads are still counting, so the counters are read and written atomically.
+//Only the thread holding a lock writes its counters, so adding is a load and a store
+#define statLoad(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define statStore(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+#define statAdd(field, n) statStore(field, (field) + (n))
+
+typedef struct LOCK_STATS LockStats;
+struct LOCK_STATS {
+   pthread_mutex_t *lock; //NULL once destroyed, until a lock with the same name takes the entry over
+   char name[LOCK_NAME_LEN];
+   unsigned long acquisitions;
+   long totalWait, totalHold;
+   long maxWait, maxHold;
+   const char *maxWaitFile, *maxHoldFile;
+   int maxWaitLine, maxHoldLine;
+   unsigned long waitHist[HIST_BUCKETS];
+   unsigned long holdHist[HIST_BUCKETS];
+   //set by whoever holds the lock, so only touched under it
+   long acquiredAt;
+   const char *holderFile;
+   int holderLine;
+};
+
+static bool statsOn = false;
+static FILE *statsFile = NULL;
+static LockStats *statsChunks[MAX_STATS_CHUNKS];
+static int trackedLocks = 0;
+static unsigned long untracked = 0; //acquisitions of locks that didn't fit in the table
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t dumpRequested = 0;
+
+typedef struct THREAD_START ThreadStart;
+struct THREAD_START {
+   void *(*func)(void *);
+   void *param;
+   Session *session;
+};
+
+//---PROTOTYPES---------------------------------------------------------
+static void *startInSession(void *start);
+static LockStats *statsFor(pthread_mutex_t *lock, const char *file, int line);
+static LockStats *findEntry(pthread_mutex_t *lock, int count);
+static LockStats *newEntry(pthread_mutex_t *lock, const char *name);
+static LockStats *entryAt(int i);
+static long nowNsec();
+static int bucketFor(long nsec);
+static void requestDump(int sig);
+static void printHistogram(const char *label, unsigned long hist[]);
+//---METHODS------------------------------------------------------------//
 
 void createThread(pthread_t *thread, void *(*func)(void *), void *param){
    int ret;
-   ret = pthread_create(thread, NULL, func, param);
+   ThreadStart *start = (ThreadStart *)malloc(sizeof(ThreadStart));
+   if(start == NULL){
+      printError();
+   }
+   start->func = func;
+   start->param = param;
+   start->session = currentSession();
+   ret = pthread_create(thread, NULL, startInSession, start);
    if(ret){
       printError();
    }
-   lockMutex(&threadCountLock);
-   incrementThreadCount();
-   unlockMutex(&threadCountLock);
 }
 
 void joinThread(pthread_t thread){
@@ -29,39 +99,265 @@ void joinThread(pthread_t thread){
   if(ret){
      printError();
   }
-  lockMutex(&threadCountLock);
-  decrementThreadCount();
-  unlockMutex(&threadCountLock);
 }
 
-void createLogThread(pthread_t *thread, void *(*func)(void *), void *param){
-   int ret;
-   ret = pthread_create(thread, NULL, func, param);
-   if(ret)
-      printError();
+/* Every thread starts out working on the session of the thread that made it */
+static void *startInSession(void *start){
+   ThreadStart run = *(ThreadStart *)start;
+   free(start);
+   setCurrentSession(run.session);
+   return run.func(run.param);
 }
 
-void joinLogThread(pthread_t thread){
+void lockMutexAt(pthread_mutex_t *lock, const char *file, int line){
    int ret;
-   ret = pthread_join(thread, NULL);
-   if(ret)
-      printError();
-}
+   LockStats *stats;
+   long start = 0, wait;
+   bool traced = tracingOn();
 
-void lockMutex(pthread_mutex_t *lock){
-   int ret;
-   ret = pthread_mutex_lock(lock);
+   if(!statsOn && !traced){
+      ret = pthread_mutex_lock(lock);
+      if(ret){
+         printError();
+      }
+      return;
+   }
+
+   ret = traced ? pthread_mutex_trylock(lock) : EBUSY;
+   if(ret == EBUSY){ //only a lock someone else holds is a wait worth timing
+      start = nowNsec();
+      ret = pthread_mutex_lock(lock);
+      if(traced){
+         traceLockWait(file, line, start);
+      }
+   }
    if(ret){
       printError();
    }
+   if(!statsOn){
+      return;
+   }
+   //holding the lock, so its stats are ours to update
+   stats = statsFor(lock, file, line);
+   if(stats != NULL){
+      stats->acquiredAt = nowNsec();
+      stats->holderFile = file;
+      stats->holderLine = line;
+      wait = start != 0 ? stats->acquiredAt - start : 0; //0 when the trylock got it
+      statAdd(stats->acquisitions, 1);
+      statAdd(stats->totalWait, wait);
+      statAdd(stats->waitHist[bucketFor(wait)], 1);
+      if(wait > stats->maxWait){
+         statStore(stats->maxWaitFile, file);
+         statStore(stats->maxWaitLine, line);
+         statStore(stats->maxWait, wait);
+      }
+   }
+   else{
+      __atomic_fetch_add(&untracked, 1, __ATOMIC_RELAXED);
+   }
 }
 
-void unlockMutex(pthread_mutex_t *lock){
+void unlockMutexAt(pthread_mutex_t *lock){
    int ret;
+   LockStats *stats;
+   long hold;
+
+   if(statsOn && (stats = statsFor(lock, NULL, 0)) != NULL && stats->holderFile != NULL){
+      hold = nowNsec() - stats->acquiredAt;
+      statAdd(stats->totalHold, hold);
+      statAdd(stats->holdHist[bucketFor(hold)], 1);
+      if(hold > stats->maxHold){
+         statStore(stats->maxHoldFile, stats->holderFile);
+         statStore(stats->maxHoldLine, stats->holderLine);
+         statStore(stats->maxHold, hold);
+      }
+      stats->holderFile = NULL;
+   }
+
    ret = pthread_mutex_unlock(lock);
    if(ret){
       printError();
    }
+
+   if(dumpRequested){ //SIGUSR1 came in, write the report from a normal thread
+      dumpRequested = 0;
+      dumpLockStats();
+   }
+}
+
+void initLockStats(){
+   char *path = getenv("FROGGER_LOCKSTATS");
+   if(path == NULL || statsOn){
+      return;
+   }
+   if(strcmp(path, "-") == 0){
+      statsFile = stderr;
+   }
+   else if((statsFile = fopen(path, "a")) == NULL){
+      fprintf(stderr, "Can't open lock stats file %s\n", path);
+      return;
+   }
+   signal(SIGUSR1, requestDump);
+   atexit(dumpLockStats);
+   statsOn = true;
+}
+
+void nameLock(pthread_mutex_t *lock, const char *name){
+   LockStats *stats;
+   int i;
+   if(!statsOn){
+      return;
+   }
+   pthread_mutex_lock(&statsLock);
+   if((stats = findEntry(lock, trackedLocks)) != NULL){
+      snprintf(stats->name, LOCK_NAME_LEN, "%s", name);
+   }
+   else{
+      //a lock made again under an old name, like a restarted session's, keeps adding to the old counts
+      for(i = 0; i < trackedLocks && stats == NULL; i++){
+         if(__atomic_load_n(&entryAt(i)->lock, __ATOMIC_ACQUIRE) == NULL &&
+            strncmp(entryAt(i)->name, name, LOCK_NAME_LEN-1) == 0){
+            stats = entryAt(i);
+            __atomic_store_n(&stats->lock, lock, __ATOMIC_RELEASE);
+         }
+      }
+      if(stats == NULL){
+         newEntry(lock, name);
+      }
+   }
+   pthread_mutex_unlock(&statsLock);
+}
+
+void destroyMutex(pthread_mutex_t *lock){
+   LockStats *stats;
+   if(statsOn){
+      pthread_mutex_lock(&statsLock);
+      if((stats = findEntry(lock, trackedLocks)) != NULL){
+         __atomic_store_n(&stats->lock, NULL, __ATOMIC_RELEASE); //the address may be reused by another lock
+      }
+      pthread_mutex_unlock(&statsLock);
+   }
+   if(pthread_mutex_destroy(lock)){
+      printError();
+   }
+}
+
+void dumpLockStats(){
+   LockStats *stats;
+   unsigned long acquisitions, missed;
+   const char *waitFile, *holdFile;
+   int i;
+   if(!statsOn){
+      return;
+   }
+
+   pthread_mutex_lock(&statsLock);
+   fprintf(statsFile, "=== lock stats ===\n");
+   for(i = 0; i < trackedLocks; i++){
+      stats = entryAt(i);
+      if((acquisitions = statLoad(stats->acquisitions)) == 0){
+         continue;
+      }
+      //a lock still in use may have counted a little more by the time each field is read
+      waitFile = statLoad(stats->maxWaitFile);
+      holdFile = statLoad(stats->maxHoldFile);
+      fprintf(statsFile, "%s: %lu acquisitions, wait mean %ldns max %ldns (%s:%d), hold mean %ldns max %ldns (%s:%d)\n",
+              stats->name, acquisitions,
+              statLoad(stats->totalWait) / (long)acquisitions, statLoad(stats->maxWait),
+              waitFile ? waitFile : "-", statLoad(stats->maxWaitLine),
+              statLoad(stats->totalHold) / (long)acquisitions, statLoad(stats->maxHold),
+              holdFile ? holdFile : "-", statLoad(stats->maxHoldLine));
+      printHistogram("wait", stats->waitHist);
+      printHistogram("hold", stats->holdHist);
+   }
+   if((missed = __atomic_load_n(&untracked, __ATOMIC_RELAXED)) > 0){
+      fprintf(statsFile, "%lu acquisitions not counted, more than %d locks\n", missed, MAX_TRACKED_LOCKS);
+   }
+   fflush(statsFile);
+   pthread_mutex_unlock(&statsLock);
+}
+
+/* Finds the stats for a lock, adding an entry named after the first call site
+   the first time an unnamed lock shows up */
+static LockStats *statsFor(pthread_mutex_t *lock, const char *file, int line){
+   LockStats *stats = findEntry(lock, __atomic_load_n(&trackedLocks, __ATOMIC_ACQUIRE));
+   char name[LOCK_NAME_LEN];
+
+   if(stats == NULL){
+      pthread_mutex_lock(&statsLock);
+      if((stats = findEntry(lock, trackedLocks)) == NULL){ //someone may have added it meanwhile
+         snprintf(name, LOCK_NAME_LEN, "%s:%d", file ? file : "lock", line);
+         stats = newEntry(lock, name);
+      }
+      pthread_mutex_unlock(&statsLock);
+   }
+   return stats;
+}
+
+/* Looks for the lock among the first `count' entries */
+static LockStats *findEntry(pthread_mutex_t *lock, int count){
+   int i;
+   for(i = 0; i < count; i++){
+      if(__atomic_load_n(&entryAt(i)->lock, __ATOMIC_ACQUIRE) == lock){
+         return entryAt(i);
+      }
+   }
+   return NULL;
+}
+
+/* Adds an entry, starting a new chunk if the last one is full. Called with
+   statsLock held. NULL if the table is full */
+static LockStats *newEntry(pthread_mutex_t *lock, const char *name){
+   LockStats *stats;
+   int chunk = trackedLocks / STATS_CHUNK;
+   if(trackedLocks == MAX_TRACKED_LOCKS){
+      return NULL;
+   }
+   if(statsChunks[chunk] == NULL && (statsChunks[chunk] = (LockStats *)calloc(STATS_CHUNK, sizeof(LockStats))) == NULL){
+      return NULL;
+   }
+   stats = entryAt(trackedLocks);
+   memset(stats, 0, sizeof(LockStats));
+   stats->lock = lock;
+   snprintf(stats->name, LOCK_NAME_LEN, "%s", name);
+   __atomic_store_n(&trackedLocks, trackedLocks+1, __ATOMIC_RELEASE); //the entry is filled in before anyone can find it
+   return stats;
+}
+
+static LockStats *entryAt(int i){
+   return &statsChunks[i / STATS_CHUNK][i % STATS_CHUNK];
+}
+
+static long nowNsec(){
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+static int bucketFor(long nsec){
+   int bucket = 0;
+   while(nsec > 1 && bucket < HIST_BUCKETS-1){
+      nsec >>= 1;
+      bucket++;
+   }
+   return bucket;
+}
+
+static void requestDump(int sig){
+   dumpRequested = 1;
+}
+
+static void printHistogram(const char *label, unsigned long hist[]){
+   unsigned long count;
+   int i;
+   fprintf(statsFile, "   %s:", label);
+   for(i = 0; i < HIST_BUCKETS; i++){
+      if((count = statLoad(hist[i])) > 0){
+         fprintf(statsFile, " <%ldns:%lu", 2L << i, count);
+      }
+   }
+   fprintf(statsFile, "\n");
 }
 
 void printError(){
@@ -3,23 +3,37 @@
 #ifndef THREADWRAPPERS_H
 #define THREADWRAPPERS_H
 
-/*Creates a pthread_t and increments thread count */
+/*Creates a pthread_t working on the same session as the caller */
 void createThread(pthread_t *thread, void *(*func)(void *), void *param);
 
-/* Safely join a pthread_t and decrements thread count*/
+/* Safely join a pthread_t */
 void joinThread(pthread_t thread);
 
-/* Safely creates a log pthread_t */
-void createLogThread(pthread_t *thread, void *(*func)(void *), void *param);
+/* Locks a mutex variable. The macro passes the call site along for the lock
+   statistics */
+#define lockMutex(lock) lockMutexAt(lock, __FILE__, __LINE__)
+void lockMutexAt(pthread_mutex_t *lock, const char *file, int line);
 
-/* Safely joins a log pthread_t */
-void joinLogThread(pthread_t thread);
+/* Unlocks a mutex variable */
+#define unlockMutex(lock) unlockMutexAt(lock)
+void unlockMutexAt(pthread_mutex_t *lock);
 
-/* Locks a mutex variable */
-void lockMutex(pthread_mutex_t *lock);
+/* Turns lock statistics on if the FROGGER_LOCKSTATS environment variable names
+   a report file ("-" for stderr). The report is written on exit and whenever
+   the process gets SIGUSR1. Costs one branch per lock when it's off */
+void initLockStats();
 
-/* Unlocks a mutex variable */
-void unlockMutex(pthread_mutex_t *lock);
+/* Names a lock in the lock statistics report. A lock given the name of one
+   that was destroyed carries on its counts */
+void nameLock(pthread_mutex_t *lock, const char *name);
+
+/* Destroys a mutex variable, dropping it from the lock statistics so its
+   address can be reused by another lock */
+void destroyMutex(pthread_mutex_t *lock);
+
+/* Writes the acquisition counts, wait and hold time histograms and worst call
+   sites of every lock to the report file */
+void dumpLockStats();
 
 /* Prints error and exits */
 void printError();
@@ -0,0 +1,208 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file is a hierarchical timer wheel for things the game does a few ticks from now, like putting the frog back
+ * on the start bank after it dies, so nothing has to sleep on the tick thread to wait for them. Level 0 has a slot
+ * for each of the next 64 ticks; each level up covers 64 times as much time with a slot per 64 slots of the level
+ * under it. Whenever level 0 wraps around, the next slot of level 1 is cascaded down into it, and so on up, so
+ * scheduling, cancelling and every tick are constant time no matter how many timers are pending. Timers come out of
+ * a pool, and only the tick thread touches the wheel, so it has no lock.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "timerwheel.h"
+#include "pool.h"
+#include "gameglobals.h"
+#include "threadwrappers.h"
+#include "session.h"
+
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define SLOT_MASK (WHEEL_SLOTS - 1)
+
+typedef struct TIMER Timer;
+struct TIMER {
+   unsigned long due;    //tick it runs on
+   unsigned long serial; //0 once it has run or been cancelled
+   TimerAction action;
+   void *arg;
+   Timer *next;
+   Timer **prev;         //the pointer that points at this timer, so it can unlink itself
+};
+
+/* One session's wheel */
+typedef struct TIMER_STATE TimerState;
+struct TIMER_STATE {
+   Timer *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+   Pool pool;
+   unsigned long now;    //last tick that was run
+   unsigned long serials;
+   int pending;
+};
+
+//---PROTOTYPES---------------------------------------------------------
+static void insert(TimerState *timers, Timer *timer);
+static void unlinkTimer(Timer *timer);
+static void cascade(TimerState *timers, int level, int slot);
+static void runSlot(TimerState *timers, int slot);
+static bool live(TimerHandle handle);
+static TimerState *state();
+//---METHODS------------------------------------------------------------//
+
+bool initTimers(){
+   TimerState *timers = (TimerState *)calloc(1, sizeof(TimerState));
+   if(timers == NULL || !poolInit(&timers->pool, sizeof(Timer), MAX_TIMERS)){
+      free(timers);
+      return false;
+   }
+   timers->now = getTick();
+   currentSession()->timers = timers;
+   return true;
+}
+
+TimerHandle scheduleTimer(long ticks, TimerAction action, void *arg){
+   TimerState *timers = state();
+   TimerHandle handle = {NULL, 0};
+   Timer *timer = (Timer *)poolAlloc(&timers->pool);
+   if(timer == NULL){
+      return handle;
+   }
+   if(timers->pending == 0){ //nothing to cascade, an empty wheel can jump straight to the current tick
+      timers->now = getTick();
+   }
+   if(ticks < 1){
+      ticks = 1;
+   }
+   else if(ticks > MAX_TIMER_TICKS){
+      ticks = MAX_TIMER_TICKS;
+   }
+   timer->due = timers->now + ticks;
+   timer->serial = ++timers->serials;
+   timer->action = action;
+   timer->arg = arg;
+   insert(timers, timer);
+   timers->pending++;
+   handle.timer = timer;
+   handle.serial = timer->serial;
+   return handle;
+}
+
+bool cancelTimer(TimerHandle *handle){
+   TimerState *timers = state();
+   bool pending = live(*handle);
+   if(pending){
+      unlinkTimer(handle->timer);
+      handle->timer->serial = 0;
+      poolFree(&timers->pool, handle->timer);
+      timers->pending--;
+   }
+   handle->timer = NULL;
+   handle->serial = 0;
+   return pending;
+}
+
+bool timerPending(TimerHandle handle){
+   return live(handle);
+}
+
+long timerRemaining(TimerHandle handle){
+   long remaining = 0;
+   if(live(handle)){
+      remaining = (long)(handle.timer->due - state()->now);
+   }
+   return remaining;
+}
+
+void runTimers(unsigned long tick){
+   TimerState *timers = state();
+   int level;
+   if(timers->pending == 0){
+      timers->now = tick;
+      return;
+   }
+   while(timers->now < tick){
+      timers->now++;
+      //level 0 wrapped, bring the next 64 ticks down from the levels above
+      for(level = 1; level < WHEEL_LEVELS && (timers->now & ((1UL << (WHEEL_BITS*level)) - 1)) == 0; level++){
+         cascade(timers, level, (timers->now >> (WHEEL_BITS*level)) & SLOT_MASK);
+      }
+      runSlot(timers, timers->now & SLOT_MASK);
+   }
+}
+
+void deleteTimers(){
+   TimerState *timers = state();
+   if(timers != NULL){
+      poolDestroy(&timers->pool);
+   }
+   free(timers);
+   currentSession()->timers = NULL;
+}
+
+/* Puts the timer in the slot of the lowest level that reaches its tick */
+static void insert(TimerState *timers, Timer *timer){
+   unsigned long ahead = timer->due - timers->now;
+   Timer **slot;
+   int level = 0;
+   while(level < WHEEL_LEVELS-1 && ahead >= 1UL << (WHEEL_BITS*(level+1))){
+      level++;
+   }
+   slot = &timers->slots[level][(timer->due >> (WHEEL_BITS*level)) & SLOT_MASK];
+   timer->next = *slot;
+   if(*slot != NULL){
+      (*slot)->prev = &timer->next;
+   }
+   timer->prev = slot;
+   *slot = timer;
+}
+
+static void unlinkTimer(Timer *timer){
+   *timer->prev = timer->next;
+   if(timer->next != NULL){
+      timer->next->prev = timer->prev;
+   }
+}
+
+/* Spreads a slot of a higher level over the levels under it, now that they reach its ticks */
+static void cascade(TimerState *timers, int level, int slot){
+   Timer *timer = timers->slots[level][slot];
+   Timer *next;
+   timers->slots[level][slot] = NULL;
+   for(; timer != NULL; timer = next){
+      next = timer->next;
+      insert(timers, timer);
+   }
+}
+
+/* Runs the timers in a level 0 slot. The slot is taken off the wheel first so
+   an action can schedule or cancel others while it runs */
+static void runSlot(TimerState *timers, int slot){
+   Timer *taken = timers->slots[0][slot];
+   Timer *timer;
+   TimerAction action;
+   void *arg;
+   timers->slots[0][slot] = NULL;
+   if(taken != NULL){
+      taken->prev = &taken; //a cancel unlinks from the taken list now
+   }
+   while((timer = taken) != NULL){
+      unlinkTimer(timer);
+      action = timer->action;
+      arg = timer->arg;
+      timer->serial = 0;
+      poolFree(&timers->pool, timer);
+      timers->pending--;
+      action(arg);
+   }
+}
+
+static bool live(TimerHandle handle){
+   return handle.timer != NULL && handle.serial != 0 && handle.timer->serial == handle.serial;
+}
+
+static TimerState *state(){
+   return currentSession()->timers;
+}
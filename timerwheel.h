@@ -0,0 +1,48 @@
+/* The header file for timerwheel.c
+*/
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+#include <stdbool.h>
+
+#define WHEEL_BITS 6   //each level of the wheel has 2^WHEEL_BITS slots
+#define WHEEL_LEVELS 4
+#define MAX_TIMER_TICKS ((1L << (WHEEL_BITS*WHEEL_LEVELS)) - 1) //longer delays are cut to this
+#define MAX_TIMERS 32  //pending in one session at once
+
+typedef void (*TimerAction)(void *arg);
+
+/* Names one scheduled action. It stops naming anything once the action has
+   run or been cancelled, even if its slot is reused. A zeroed handle names
+   nothing */
+typedef struct TIMER_HANDLE TimerHandle;
+struct TIMER_HANDLE {
+   struct TIMER *timer;
+   unsigned long serial;
+};
+
+/* Sets up an empty timer wheel for the current session */
+bool initTimers();
+
+/* Schedules `action' to be called with `arg' on the tick thread `ticks'
+   ticks from the current tick, at least one. Returns a handle naming nothing
+   if MAX_TIMERS are already pending */
+TimerHandle scheduleTimer(long ticks, TimerAction action, void *arg);
+
+/* Cancels a pending action. Returns false if it already ran or was cancelled */
+bool cancelTimer(TimerHandle *handle);
+
+/* Checks if the action is still waiting to run */
+bool timerPending(TimerHandle handle);
+
+/* Returns how many ticks are left until the action runs, 0 if it isn't pending */
+long timerRemaining(TimerHandle handle);
+
+/* Called by the game loop at the start of every tick, before its keys. Runs
+   every action due on or before `tick', earlier ticks first */
+void runTimers(unsigned long tick);
+
+/* Frees the wheel. Actions still pending never run */
+void deleteTimers();
+
+#endif
@@ -0,0 +1,178 @@
+/* COMP 3430
+ * PROF: JIM YOUNG
+ * REBECCA TIESSEN
+ *
+ * This file traces what every thread was doing, so a stutter can be pinned on the thread and the call that caused it.
+ * Spans are timed on the monotonic clock and kept as complete events in a ring per thread, made the first time the
+ * thread traces anything. Only its own thread writes a ring and it publishes how far it has written with one atomic
+ * store, so tracing never takes a lock, and the rings are linked into a list with a compare and swap. A thread that
+ * ends leaves its ring behind, and on exit every ring is written out as Chrome trace event JSON with the session as
+ * the process, so each game shows up on its own. When tracing is off every span is one branch on a flag.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "trace.h"
+#include "session.h"
+
+#define NSEC_PER_SEC 1000000000L
+#define NSEC_PER_USEC 1000.0
+
+typedef struct TRACE_EVENT TraceEvent;
+struct TRACE_EVENT {
+   const char *name;
+   const char *file; //call site of a lock wait, NULL for other spans
+   int line;
+   int session;
+   long start, duration;
+};
+
+typedef struct OPEN_SPAN OpenSpan;
+struct OPEN_SPAN {
+   const char *name;
+   long start;
+};
+
+/* One thread's spans. Only the thread writes it */
+typedef struct TRACE_RING TraceRing;
+struct TRACE_RING {
+   TraceEvent events[TRACE_EVENTS];
+   atomic_ulong written; //events ever written, the newest TRACE_EVENTS of them are still here
+   int tid;
+   OpenSpan open[MAX_SPAN_DEPTH];
+   int depth;
+   TraceRing *next;
+};
+
+atomic_bool tracing = false;
+static FILE *traceFile = NULL;
+static long traceStart;
+static _Atomic(TraceRing *) rings = NULL;
+static atomic_int nextTid = 1;
+static __thread TraceRing *ring = NULL;
+
+//---PROTOTYPES---------------------------------------------------------
+static TraceRing *threadRing();
+static void record(TraceRing *r, const char *name, const char *file, int line, long start);
+static void writeRing(TraceRing *r, bool *first);
+static long nowNsec();
+//---METHODS------------------------------------------------------------//
+
+void traceBeginSpan(const char *name){
+   TraceRing *r = threadRing();
+   if(r == NULL){
+      return;
+   }
+   if(r->depth < MAX_SPAN_DEPTH){
+      r->open[r->depth].name = name;
+      r->open[r->depth].start = nowNsec();
+   }
+   r->depth++; //counted even when too deep so the ends still match up
+}
+
+void traceEndSpan(){
+   TraceRing *r = threadRing();
+   if(r == NULL || r->depth == 0){
+      return;
+   }
+   r->depth--;
+   if(r->depth < MAX_SPAN_DEPTH){
+      record(r, r->open[r->depth].name, NULL, 0, r->open[r->depth].start);
+   }
+}
+
+void traceLockWait(const char *file, int line, long start){
+   TraceRing *r = threadRing();
+   if(r != NULL){
+      record(r, "lock wait", file, line, start);
+   }
+}
+
+void initTrace(){
+   char *path = getenv("FROGGER_TRACE");
+   if(path == NULL || tracingOn()){
+      return;
+   }
+   if((traceFile = fopen(path, "w")) == NULL){
+      fprintf(stderr, "Can't open trace file %s\n", path);
+      return;
+   }
+   traceStart = nowNsec();
+   atexit(writeTrace);
+   atomic_store_explicit(&tracing, true, memory_order_release);
+}
+
+void writeTrace(){
+   TraceRing *r;
+   bool first = true;
+   if(traceFile == NULL){
+      return;
+   }
+   atomic_store_explicit(&tracing, false, memory_order_release); //anything still running stops adding spans
+   fprintf(traceFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+   for(r = atomic_load(&rings); r != NULL; r = r->next){ //left allocated, a thread may still hold its ring
+      writeRing(r, &first);
+   }
+   fprintf(traceFile, "\n]}\n");
+   fclose(traceFile);
+   traceFile = NULL;
+}
+
+/* The calling thread's ring, made and linked in the first time it is needed.
+   NULL if there's no memory for it */
+static TraceRing *threadRing(){
+   TraceRing *r = ring;
+   if(r == NULL){
+      r = (TraceRing *)calloc(1, sizeof(TraceRing));
+      if(r == NULL){
+         return NULL;
+      }
+      r->tid = atomic_fetch_add(&nextTid, 1);
+      r->next = atomic_load(&rings);
+      while(!atomic_compare_exchange_weak(&rings, &r->next, r));
+      ring = r;
+   }
+   return r;
+}
+
+/* Adds a span that ends now. The event is filled in before the count moves
+   past it, so the writer never reads half of one */
+static void record(TraceRing *r, const char *name, const char *file, int line, long start){
+   unsigned long written = atomic_load_explicit(&r->written, memory_order_relaxed);
+   TraceEvent *event = &r->events[written % TRACE_EVENTS];
+   Session *session = currentSession();
+   event->name = name;
+   event->file = file;
+   event->line = line;
+   event->session = session != NULL ? session->id : 0;
+   event->start = start;
+   event->duration = nowNsec() - start;
+   atomic_store_explicit(&r->written, written + 1, memory_order_release);
+}
+
+static void writeRing(TraceRing *r, bool *first){
+   unsigned long written = atomic_load_explicit(&r->written, memory_order_acquire);
+   unsigned long i = written > TRACE_EVENTS ? written - TRACE_EVENTS : 0;
+   TraceEvent *event;
+   for(; i < written; i++){
+      event = &r->events[i % TRACE_EVENTS];
+      fprintf(traceFile, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+              *first ? "" : ",", event->name, event->session, r->tid,
+              (event->start - traceStart) / NSEC_PER_USEC, event->duration / NSEC_PER_USEC);
+      if(event->file != NULL){
+         fprintf(traceFile, ",\"args\":{\"site\":\"%s:%d\"}", event->file, event->line);
+      }
+      fprintf(traceFile, "}");
+      *first = false;
+   }
+}
+
+static long nowNsec(){
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
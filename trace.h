@@ -0,0 +1,43 @@
+/* The header file for trace.c
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define TRACE_EVENTS 65536 //spans kept per thread, the oldest are overwritten after this
+#define MAX_SPAN_DEPTH 32  //spans nested deeper than this are left out
+
+/* Set at startup when tracing is on and cleared when the trace is written.
+   Only read it through the macros */
+extern atomic_bool tracing;
+
+/* Checks if spans are being traced, with an acquire load that pairs with the
+   release stores turning tracing on and off */
+#define tracingOn() atomic_load_explicit(&tracing, memory_order_acquire)
+
+/* Starts a span named `name', a string that outlives the process' threads,
+   usually a literal. Costs one branch when tracing is off */
+#define traceBegin(name) (tracingOn() ? traceBeginSpan(name) : (void)0)
+
+/* Ends the calling thread's innermost span */
+#define traceEnd() (tracingOn() ? traceEndSpan() : (void)0)
+
+void traceBeginSpan(const char *name);
+void traceEndSpan();
+
+/* Records a wait for the lock taken at `file':`line' that started at `start'
+   on the monotonic clock, in nanoseconds, and ends now */
+void traceLockWait(const char *file, int line, long start);
+
+/* Turns tracing on if the FROGGER_TRACE environment variable names a trace
+   file. Every thread keeps its own ring of spans, and on exit they are all
+   written to the file as Chrome trace event JSON, which Perfetto and
+   chrome://tracing open. Call it before any thread but the main one starts */
+void initTrace();
+
+/* Writes every thread's spans to the trace file */
+void writeTrace();
+
+#endif